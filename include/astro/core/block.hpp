@@ -2,10 +2,14 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <span>
 #include "astro/core/hash.hpp"
 #include "astro/core/transaction.hpp"
 
 namespace astro::core {
+  // Size of BlockHeader::serialize(): version, prev_hash, merkle_root, timestamp, nonce.
+  inline constexpr size_t BLOCK_HEADER_BYTES = 4 + 32 + 32 + 8 + 8;
+
   struct BlockHeader {
     uint32_t version = 1;
     Hash256 prev_hash{};
@@ -16,6 +20,8 @@ namespace astro::core {
     std::vector<uint8_t> serialize() const;
 
     Hash256 hash() const;
+
+    bool operator==(const BlockHeader&) const = default;
   };
 
   struct Block {
@@ -26,6 +32,12 @@ namespace astro::core {
     std::vector<uint8_t> serialize() const;
   };
 
+  // Inverses of serialize(); throw SerializeError on truncated input.
+  BlockHeader deserialize_header(std::span<const uint8_t> bytes);
+  Block deserialize_block(std::span<const uint8_t> bytes);
+  // Decodes what follows the header in Block::serialize(): u32 num_txs + txs.
+  std::vector<Transaction> deserialize_block_body(std::span<const uint8_t> bytes);
+
   Hash256 compute_merkle_root(const std::vector<Transaction>& transactions);
   Hash256 empty_merkle_root();
 
@@ -0,0 +1,98 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+#include "astro/core/block.hpp"
+#include "astro/core/chain.hpp"
+#include "astro/core/ledger.hpp"
+#include "astro/core/merkle.hpp"
+
+namespace astro::core {
+  struct BlockStreamLimits {
+    size_t max_block_bytes = 32u << 20;
+    size_t max_transaction_bytes = 64u << 10;
+  };
+
+  // Runs validate_block's checks on a Block::serialize() encoding as its
+  // bytes arrive, without building the Block. The header is checked as
+  // soon as it is in; each transaction is checked for coinbase placement
+  // and nonce order, hashed into the merkle root and has its signature
+  // queued for checking, then dropped. Memory is one transaction, the
+  // merkle frontier and the queued signature checks, whatever the block's
+  // size. Only the canonical encoding is accepted: anything
+  // deserialize_block would have skipped over or truncated is
+  // ValidationError::MalformedBlock.
+  //
+  // Each check rejects as soon as it fails, so a block with several faults
+  // may be reported with a different one than validate_block would give.
+  // Like validate_block, runs on the chain's thread, and the chain must not
+  // change until finish().
+  class BlockStreamValidator {
+    public:
+      // With `verify_threads` > 0, signatures are checked on that many
+      // workers while feed() goes on parsing; with 0, inline in feed().
+      explicit BlockStreamValidator(const Chain& chain, BlockStreamLimits limits = {}, size_t verify_threads = 0);
+      ~BlockStreamValidator();
+
+      BlockStreamValidator(const BlockStreamValidator&) = delete;
+      BlockStreamValidator& operator=(const BlockStreamValidator&) = delete;
+
+      // The next bytes of the block, split anywhere. Returns false once the
+      // block is rejected; its remaining bytes need not be read.
+      bool feed(std::span<const uint8_t> bytes);
+      // Call after the last byte: waits for the signature checks and
+      // checks the merkle root.
+      ValidationResult finish();
+
+      // Set once the header's bytes are in and it has passed.
+      const std::optional<BlockHeader>& header() const { return header_; }
+      uint64_t bytes_fed() const { return bytes_fed_; }
+
+    private:
+      enum class Part { Header, Count, Length, Transaction, Done };
+
+      struct SignatureCheck {
+        size_t index;
+        std::vector<uint8_t> pubkey;
+        std::vector<uint8_t> message;
+        std::vector<uint8_t> signature;
+      };
+
+      bool consume(std::span<const uint8_t> part);
+      bool consume_transaction(std::span<const uint8_t> bytes);
+      bool reject(ValidationError error, size_t index = ~0ull);
+      void dispatch(SignatureCheck check);
+      void run_verifier();
+      void record_bad_signature(size_t index);
+
+      const Chain& chain_;
+      const BlockStreamLimits limits_;
+      const bool is_genesis_candidate_;
+      std::optional<Ledger::NonceCheck> nonces_;
+
+      Part part_ = Part::Header;
+      size_t need_ = BLOCK_HEADER_BYTES;
+      std::vector<uint8_t> pending_;  // a part split across feed() calls
+      uint64_t bytes_fed_ = 0;
+      uint32_t transactions_ = 0;
+      uint32_t next_index_ = 0;
+      std::optional<BlockHeader> header_;
+      MerkleAccumulator merkle_;
+      std::optional<ValidationResult> verdict_;
+
+      // Signature workers.
+      std::mutex mutex_;
+      std::condition_variable work_cv_;
+      std::condition_variable room_cv_;
+      std::deque<SignatureCheck> queue_;
+      size_t in_flight_ = 0;
+      size_t bad_signature_ = ~0ull;  // lowest failing index
+      bool stopping_ = false;
+      std::vector<std::thread> verifiers_;
+  };
+}
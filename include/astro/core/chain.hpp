@@ -1,11 +1,22 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <map>
 #include <cstdint>
+#include <mutex>
 #include <vector>
 #include <optional>
+#include <unordered_map>
+#include <future>
+#include <memory>
+#include <span>
 #include "astro/core/block.hpp"
+#include "astro/core/ledger.hpp"
+#include "astro/core/lru_cache.hpp"
+#include "astro/core/merkle.hpp"
 #include "astro/core/transaction.hpp"
 
-namespace astro { namespace storage { class BlockStore; } }
+namespace astro { namespace storage { class BlockStorage; class AsyncBlockWriter; } }
 
 namespace astro::core {
 
@@ -20,6 +31,9 @@ namespace astro::core {
     CoinBaseMisplaced,
     CoinbaseInNonGenesisBlock,
     InsufficientPOW,
+    ReplayedNonce,
+    MalformedBlock,  // bytes that don't decode to a block
+    OversizedBlock,  // past a BlockStreamLimits bound
   };
 
   struct ValidationResult {
@@ -28,40 +42,301 @@ namespace astro::core {
     size_t transaction_index = ~0LL;
   };
 
+  // Where validation time goes, stage by stage, in the order validate_block
+  // runs them. Restore's parallel body checks are not counted. nanos is
+  // only measured in builds with ASTRO_WITH_METRICS.
+  struct ValidationStats {
+    struct Stage {
+      uint64_t runs = 0;
+      uint64_t rejected = 0;
+      uint64_t nanos = 0;
+    };
+    Stage header;      // linkage, timestamp, PoW
+    Stage structure;   // coinbase rules, merkle root
+    Stage signatures;
+  };
+
+  struct AsyncAppendResult {
+    ValidationResult validation;
+    // Ready once the block is durable; rethrows the store error if the write
+    // failed. Only valid() when validation passed.
+    std::future<void> durable;
+  };
+
+  struct BatchAppendResult {
+    // Blocks appended and persisted, which is also the index of the first
+    // block that wasn't. Equals the batch size on success.
+    size_t appended = 0;
+    // Why block `appended` was rejected; a store failure is reported as
+    // invalid with ValidationError::None and nothing appended.
+    ValidationResult validation;
+  };
+
+  struct TxInclusion {
+    size_t height = 0;
+    size_t index = 0;  // position in the block
+    // From the tx hash to the block's merkle_root; nullopt when the chain
+    // no longer has the block's body.
+    std::optional<MerkleProof> proof;
+  };
+
+  // The validated header chain, with each header's hash. Restoring with a
+  // snapshot skips the body checks of stored blocks whose header matches it,
+  // so only blocks appended since are fully validated. Saved and loaded by
+  // astro/storage/chain_snapshot.hpp.
+  struct ChainSnapshot {
+    std::vector<BlockHeader> headers;
+    std::vector<Hash256> hashes;
+    // The transaction index, when the chain keeps one.
+    struct TxEntry {
+      Hash256 tx_hash{};
+      uint64_t height = 0;
+      uint32_t index = 0;
+    };
+    bool has_tx_index = false;
+    std::vector<TxEntry> transactions;
+    // Ledger state after the last block, when the chain keeps one.
+    std::optional<Ledger> ledger;
+  };
+
   struct ChainConfig {
     uint32_t difficulty_bits = 0;
     bool enforce_genesis_pow = false;
+    // Pruning: keep transaction bodies only for the newest `keep_recent_bodies`
+    // blocks and within `body_byte_budget` bytes (0 = no limit). Headers are
+    // always kept and the tip keeps its body, so validation is unaffected.
+    size_t keep_recent_bodies = 0;
+    uint64_t body_byte_budget = 0;
+    // Paged chains (constructed with a body store): bodies read back from
+    // the store are kept in an LRU cache of this many blocks.
+    size_t body_cache_blocks = 256;
+    // Threads verifying block bodies in restore_from_store (0 = one per core).
+    size_t restore_threads = 0;
+    // Assume-valid checkpoint: on restore, blocks at or below it skip
+    // signature checks; linkage, merkle roots, PoW and record checksums are
+    // still checked. Give a height, a hash or both. With a hash, the skip is
+    // only kept if that block turns up on the restored chain (at the given
+    // height, if any); otherwise the restore is redone with full checks.
+    std::optional<uint64_t> assume_valid_height{};
+    std::optional<Hash256> assume_valid_hash{};
+    bool force_full_verification = false;
+    // Maintain a tx_hash -> (height, index) map for find_transaction(). It is
+    // rebuilt by restore_from_store (on the verifier threads, from hashes
+    // the merkle check computes anyway) unless a snapshot carries it.
+    bool index_transactions = false;
+    // Keep a Ledger of balances and nonces, and reject blocks where a
+    // sender's nonce doesn't rise (ValidationError::ReplayedNonce). Needs
+    // every body to rebuild it, so it can't be combined with pruning
+    // (std::invalid_argument), and restoring it from a store with pruned
+    // bodies throws unless a snapshot's ledger covers them.
+    bool track_ledger = false;
   };
 
+  // The chain's headers as of one moment, published by Chain after every
+  // change. Any thread may take one with Chain::view() and read it for as
+  // long as it likes, without locks, while the chain keeps appending.
+  class ChainView {
+    public:
+      // Header storage shared by the views of one chain. A chain only writes
+      // slots at or past the height of every view it has published.
+      static constexpr size_t CHUNK_BLOCKS = 1024;
+      struct Chunk {
+        std::array<BlockHeader, CHUNK_BLOCKS> headers;
+        std::array<Hash256, CHUNK_BLOCKS> hashes;
+      };
+      using Spine = std::vector<std::shared_ptr<Chunk>>;
+
+      ChainView() = default;
+      ChainView(std::shared_ptr<const Spine> spine, size_t height, uint32_t difficulty_bits)
+        : spine_(std::move(spine)), height_(height), difficulty_bits_(difficulty_bits) {}
+
+      size_t height() const { return height_; }
+      uint32_t difficulty_bits() const { return difficulty_bits_; }
+      // Both require height < height().
+      const BlockHeader& header_at(size_t height) const { return chunk(height).headers[height % CHUNK_BLOCKS]; }
+      const Hash256& hash_at(size_t height) const { return chunk(height).hashes[height % CHUNK_BLOCKS]; }
+      const BlockHeader* tip_header() const { return height_ == 0 ? nullptr : &header_at(height_ - 1); }
+      std::optional<Hash256> tip_hash() const;
+
+      // Same as Chain::build_block_from_transactions, on this view's tip.
+      Block build_block_from_transactions(std::vector<Transaction> transactions, uint64_t timestamp) const;
+      // Headers and hashes only; Chain::snapshot() adds the tx index and
+      // ledger. Cheap to call from any thread, as views are immutable.
+      ChainSnapshot snapshot() const;
+
+    private:
+      const Chunk& chunk(size_t height) const { return *(*spine_)[height / CHUNK_BLOCKS]; }
+
+      std::shared_ptr<const Spine> spine_;
+      size_t height_ = 0;
+      uint32_t difficulty_bits_ = 0;
+  };
+
+  // Not thread-safe: one thread appends, restores and reads. Other threads
+  // read through view().
   class Chain {
     public:
       explicit Chain(ChainConfig config = {});
+      // Paged chain: only headers, hashes and the tip's body stay in memory,
+      // and get_block() reads other bodies back from `body_store`, which must
+      // be the store this chain restores from and appends to. The store then
+      // keeps every body; it is never asked to prune.
+      Chain(ChainConfig config, astro::storage::BlockStorage& body_store);
 
       const ChainConfig& config() const { return config_;}
-      void set_difficulty_bits(uint32_t bits) { config_.difficulty_bits = bits; }
+      void set_difficulty_bits(uint32_t bits);
+      // The latest published view; may be called from any thread. Readers
+      // that poll can hold on to a view until view_height() moves past it.
+      std::shared_ptr<const ChainView> view() const { return views_.load(); }
+      size_t view_height() const { return views_.published_height(); }
       size_t height() const { return blocks_.size();}
 
+      // Hashes are computed once at append time; these never rehash.
       std::optional<Hash256> tip_hash() const;
+      std::optional<Hash256> hash_at(size_t height) const;
+      // Height of the block with this header hash, in O(1).
+      std::optional<size_t> find_by_hash(const Hash256& hash) const;
+      // Where a transaction was confirmed, with a merkle proof built from
+      // that block alone. Always nullopt unless index_transactions is set.
+      std::optional<TxInclusion> find_transaction(const Hash256& tx_hash) const;
+      // nullptr unless track_ledger is set.
+      const Ledger* ledger() const { return config_.track_ledger ? &ledger_ : nullptr; }
       const Block* tip() const { return blocks_.empty() ? nullptr : &blocks_.back();}
+      // Invalidated by appends; in a pruned or paged chain the block may
+      // have no transactions. Prefer get_block().
       const Block* block_at(size_t index) const;
+      // The full block at `height`, its body paged in from the store when a
+      // paged chain has evicted it. The handle stays valid regardless of
+      // later appends or cache evictions. nullptr past the tip.
+      std::shared_ptr<const Block> get_block(size_t height) const;
 
+      // Linkage to the tip, timestamp and PoW, for header-first sync.
+      // validate_block runs this first, then checks the body's structure
+      // (coinbase rules, merkle root), then its signatures, each stage
+      // rejecting before the next, costlier one runs.
+      ValidationResult validate_header(const BlockHeader& header) const;
+      // Headers extending the tip, each checked against the one before.
+      // `valid` gets the length of the valid prefix.
+      ValidationResult validate_headers(std::span<const BlockHeader> headers, size_t* valid = nullptr) const;
       ValidationResult validate_block(const Block& block) const;
+      const ValidationStats& validation_stats() const { return stats_; }
+      void reset_validation_stats() { stats_ = {}; }
 
       ValidationResult append_block(const Block& block);
 
       Block build_block_from_transactions(std::vector<Transaction> transactions, uint64_t timestamp) const;
 
-      // Load blocks from the block store (verifies each via validate_block).
-      // If the chain is empty, the first valid block becomes genesis.
-      void restore_from_store(astro::storage::BlockStore& store);
+      // Load blocks from the block store, applying the same checks as
+      // validate_block and stopping at the first invalid block. If the chain
+      // is empty, the first valid block becomes genesis. Blocks the store has
+      // pruned to headers are checked for linkage, timestamps and PoW only.
+      // Body checks run on `restore_threads` workers while the store is read.
+      // Signatures at or below an assume-valid checkpoint are not rechecked,
+      // and blocks covered by `snapshot` only have their headers checked.
+      // A store that fails to read throws, after the blocks before the
+      // failure have been restored and checked as a full restore would.
+      void restore_from_store(astro::storage::BlockStorage& store, const ChainSnapshot* snapshot = nullptr);
+
+      // Validate then append AND persist atomically. With pruning configured,
+      // the store is asked to drop the bodies the chain has dropped; if that
+      // fails, the append still stands and the next one asks again.
+      ValidationResult append_and_store(const Block& block, astro::storage::BlockStorage& store);
 
-      // Validate then append AND persist atomically.
-      ValidationResult append_and_store(const Block& block, astro::storage::BlockStore& store);
+      // Validate, append in memory right away, and hand the block to the writer
+      // thread. The chain runs ahead of disk until `durable` resolves. The
+      // store belongs to the writer thread, so it is not pruned from here.
+      AsyncAppendResult append_and_store_async(const Block& block, astro::storage::AsyncBlockWriter& writer);
+      // Blocks below `height` have reached the store: their `durable` futures
+      // are ready. Until then a paged chain keeps their bodies in memory,
+      // whatever body_cache_blocks is, since the store can't serve them yet.
+      void mark_durable(size_t height);
+
+      // Validate `blocks` in order and persist the valid prefix with one
+      // store write and one fsync. Blocks before the first invalid one are
+      // kept; nothing is appended if the store write fails.
+      BatchAppendResult append_blocks(std::span<const Block> blocks, astro::storage::BlockStorage& store);
+
+      // Blocks below this height have had their transactions dropped, or in
+      // a paged chain, left to the store.
+      size_t pruned_height() const { return pruned_; }
+      uint64_t retained_body_bytes() const { return body_bytes_; }
 
       const std::vector<Block>& blocks() const { return blocks_; }
 
+      // Copies the headers, cached hashes, tx index and ledger; no hashing
+      // or I/O.
+      ChainSnapshot snapshot() const;
+
     private:
+      ValidationResult validate_header_after(const BlockHeader& header, const BlockHeader* parent,
+                                             const Hash256& parent_hash, Hash256* hash_out) const;
+      ValidationResult validate_block_after(const Block& block, const BlockHeader* parent, const Hash256& parent_hash,
+                                            Hash256* hash_out, std::vector<Hash256>* tx_hashes_out = nullptr) const;
+      static ValidationResult validate_link(const BlockHeader& header, const BlockHeader* parent, const Hash256& parent_hash);
+      ValidationResult validate_pow(const Hash256& header_hash, bool is_genesis_candidate) const;
+      const BlockHeader* tip_header() const { return blocks_.empty() ? nullptr : &blocks_.back().header; }
+      static ValidationResult validate_body(const Block& block, bool is_genesis_candidate, bool check_signatures = true,
+                                            std::vector<Hash256>* tx_hashes = nullptr);
+      static ValidationResult validate_structure(const Block& block, bool is_genesis_candidate,
+                                                 std::vector<Hash256>* tx_hashes);
+      static ValidationResult validate_signatures(const Block& block, bool is_genesis_candidate);
+      bool restore_blocks(astro::storage::BlockStorage& store, bool assume_valid, const ChainSnapshot* snapshot);
+      void push_block(Block block, const Hash256& hash, std::vector<Hash256> tx_hashes = {});
+      void index_hash(const Hash256& hash);
+      void index_transactions(size_t height, const Block& block, std::vector<Hash256> tx_hashes);
+      void enforce_retention();
+      ValidationResult apply_to_ledger(const Block& block, Ledger::Undo* undo);
+      void rebuild_ledger(astro::storage::BlockStorage& store);
+
+      // The writer's side of view(). A copy gets chunks of its own, so two
+      // chains never write into storage that a view of the other can see.
+      class ViewPublisher {
+        public:
+          ViewPublisher() = default;
+          ViewPublisher(const ViewPublisher& other);
+          ViewPublisher& operator=(const ViewPublisher& other);
+          ViewPublisher(ViewPublisher&& other);
+          ViewPublisher& operator=(ViewPublisher&& other);
+
+          // Fills the slot at the current height; not visible until publish().
+          void append(const BlockHeader& header, const Hash256& hash);
+          // Moves to fresh chunks holding the first `height` blocks.
+          void truncate(size_t height);
+          void publish(uint32_t difficulty_bits);
+          std::shared_ptr<const ChainView> load() const;
+          size_t published_height() const { return published_height_.load(std::memory_order_acquire); }
+
+        private:
+          std::shared_ptr<const ChainView::Spine> spine_ = std::make_shared<const ChainView::Spine>();
+          size_t height_ = 0;
+          // Held only to copy or swap the pointer. (libstdc++ 12's
+          // atomic<shared_ptr> is a spinlock too, and its load() releases
+          // it with relaxed ordering.)
+          mutable std::mutex mutex_;
+          std::shared_ptr<const ChainView> view_ = std::make_shared<const ChainView>();
+          std::atomic<size_t> published_height_{0};
+      };
+
       ChainConfig config_{};
+      ViewPublisher views_;
       std::vector<Block> blocks_;
+      std::vector<Hash256> hashes_;  // hashes_[h] == blocks_[h].header.hash()
+      std::unordered_map<Hash256, size_t, DigestHasher> heights_;
+      struct TxPosition {
+        uint64_t height;
+        uint32_t index;
+      };
+      std::unordered_map<Hash256, TxPosition, DigestHasher> tx_index_;
+      Ledger ledger_;
+      mutable ValidationStats stats_;
+      size_t pruned_ = 0;
+      astro::storage::BlockStorage* body_store_ = nullptr;
+      mutable LruCache<size_t, std::shared_ptr<const Block>> bodies_;
+      // Heights [unsynced_from_, unsynced_to_) were appended asynchronously
+      // and aren't known to be durable; their evicted bodies are pinned here.
+      size_t unsynced_from_ = 0;
+      size_t unsynced_to_ = 0;
+      std::map<size_t, std::shared_ptr<const Block>> unsynced_bodies_;
+      uint64_t body_bytes_ = 0;  // serialized size of the bodies still held
   };
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <thread>
+#include "astro/core/chain.hpp"
+#include "astro/core/mpsc_queue.hpp"
+
+namespace astro::core {
+  // Owns a Chain and applies blocks submitted from any number of threads on
+  // a thread of its own, persisting them to `store`. Submitters push onto a
+  // lock-free queue and never wait on each other or on the writer. Each gets
+  // its block's ValidationResult through a future, which resolves once the
+  // block is stored or rejected. Blocks that queue up while the writer is
+  // busy are validated in submission order and committed together, with one
+  // store write (Chain::append_blocks).
+  //
+  // Other threads read the chain through view(). The store must outlive the
+  // writer and is not to be written by anything else meanwhile.
+  class ChainWriter {
+    public:
+      ChainWriter(Chain chain, astro::storage::BlockStorage& store, size_t max_batch = 256);
+      // Applies everything already submitted, then stops. No submit() may
+      // race with the destructor.
+      ~ChainWriter();
+
+      ChainWriter(const ChainWriter&) = delete;
+      ChainWriter& operator=(const ChainWriter&) = delete;
+
+      // A failed store write resolves the future with {false, None}. If
+      // applying throws (a sender key that doesn't parse, say), the future
+      // of that block and of those after it in its batch rethrow it.
+      std::future<ValidationResult> submit(Block block);
+
+      std::shared_ptr<const ChainView> view() const { return chain_.view(); }
+
+      // Waits until everything submitted before the call has been applied.
+      void flush();
+
+      // Store writes so far.
+      uint64_t commits() const { return commits_.load(std::memory_order_relaxed); }
+
+    private:
+      struct Submission {
+        Block block;
+        std::promise<ValidationResult> result;
+      };
+
+      void run();
+      void apply(std::vector<Submission>& batch);
+
+      Chain chain_;
+      astro::storage::BlockStorage& store_;
+      size_t max_batch_;
+      MpscQueue<Submission> queue_;
+      std::atomic<uint64_t> submitted_{0};
+      std::atomic<uint64_t> applied_{0};
+      std::atomic<uint64_t> commits_{0};
+      // Bumped to wake the writer, which only waits on it after announcing
+      // so in `sleeping_`; producers skip the wakeup otherwise.
+      std::atomic<uint32_t> wake_{0};
+      std::atomic<bool> sleeping_{false};
+      std::atomic<bool> stopping_{false};
+      std::thread thread_;
+  };
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+namespace astro::core {
+  // CRC-32C (Castagnoli). `seed` is a previous result, so a buffer can be
+  // checksummed in pieces: crc32c(b, crc32c(a)) == crc32c(a || b).
+  // Uses the SSE4.2 crc32 instruction when the CPU has it.
+  uint32_t crc32c(std::span<const uint8_t> data, uint32_t seed = 0);
+
+  // Table-driven fallback; always available, same results as crc32c().
+  uint32_t crc32c_software(std::span<const uint8_t> data, uint32_t seed = 0);
+
+  bool crc32c_hardware_available();
+}
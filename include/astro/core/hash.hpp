@@ -1,5 +1,8 @@
 #pragma once
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <span>
 #include <string>
 
@@ -7,6 +10,19 @@ namespace astro::core {
   using Hash256 = std::array<uint8_t, 32>;
   using Hash160 = std::array<uint8_t, 20>;
 
+  // Hasher for digest-keyed maps. The last word is used as is: proof of work
+  // zeroes a block hash from its first byte, but its tail stays uniformly
+  // random, as every other digest's does.
+  struct DigestHasher {
+    template <size_t N>
+    size_t operator()(const std::array<uint8_t, N>& digest) const noexcept {
+      static_assert(N >= sizeof(size_t));
+      size_t word;
+      std::memcpy(&word, digest.data() + N - sizeof(word), sizeof(word));
+      return word;
+    }
+  };
+
   auto sha256(std::span<const uint8_t> data) -> Hash256;
   auto hash160(std::span<const uint8_t> data) -> Hash160;
   auto hash_concat(std::span<const uint8_t> left, std::span<const uint8_t> right) -> Hash256;
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "astro/core/block.hpp"
+#include "astro/core/hash.hpp"
+#include "astro/core/serializer.hpp"
+
+namespace astro::core {
+  // Account state derived from the chain and updated one block at a time.
+  // Senders are keyed by hash160 of from_pub_pem and recipients by to_label.
+  // Nothing links a key to a label, so what a key sent and what a label
+  // received are tracked separately. Not thread-safe.
+  class Ledger {
+    public:
+      struct Sender {
+        uint64_t sent = 0;  // sum of amounts
+        uint64_t last_nonce = 0;
+        uint64_t tx_count = 0;
+        bool operator==(const Sender&) const = default;
+      };
+
+      // State that apply() overwrote, for undo(). Entries are in the order
+      // they were touched; nullopt means the account didn't exist.
+      struct Undo {
+        std::vector<std::pair<Hash160, std::optional<Sender>>> senders;
+        std::vector<std::pair<std::string, std::optional<uint64_t>>> recipients;
+      };
+
+      const Sender* sender(const Hash160& key_hash) const;
+      uint64_t received(const std::string& label) const;
+      size_t sender_count() const { return senders_.size(); }
+      size_t recipient_count() const { return received_.size(); }
+
+      // Each sender's nonces must rise, across blocks and within one. If a
+      // transaction repeats or lowers its sender's nonce, check() returns
+      // false with its index in `bad_tx`, and so does apply(), changing
+      // nothing.
+      bool check(const Block& block, size_t* bad_tx = nullptr) const;
+      // The same rule, one sender key and nonce at a time in block order,
+      // for callers that never hold the whole block.
+      class NonceCheck {
+        public:
+          explicit NonceCheck(const Ledger& ledger) : ledger_(ledger) {}
+          bool next(const Hash160& key, uint64_t nonce);
+
+        private:
+          const Ledger& ledger_;
+          // Blocks rarely carry more than one transaction per sender, so
+          // in-block nonces are tracked in a short list rather than a map.
+          std::vector<std::pair<Hash160, uint64_t>> seen_;
+      };
+      bool apply(const Block& block, Undo* undo = nullptr, size_t* bad_tx = nullptr);
+      // Reverts the apply() that produced `undo`. Undo the most recent
+      // block first.
+      void undo(const Undo& undo);
+
+      // Used by chain snapshots. read() throws SerializeError on bad input.
+      void write(ByteWriter& writer) const;
+      static Ledger read(ByteReader& reader);
+
+      bool operator==(const Ledger&) const = default;
+
+    private:
+      // check(), handing back each transaction's sender key (nullopt for a
+      // coinbase) so apply() hashes every key once.
+      bool check(const Block& block, std::vector<std::optional<Hash160>>& keys, size_t* bad_tx) const;
+
+      std::unordered_map<Hash160, Sender, DigestHasher> senders_;
+      std::unordered_map<std::string, uint64_t> received_;
+  };
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace astro::core {
+  // Map holding at most `capacity` entries, evicting the least recently used.
+  // A capacity of 0 holds nothing. Not thread-safe.
+  template <class Key, class Value>
+  class LruCache {
+    public:
+      explicit LruCache(size_t capacity = 0) : capacity_(capacity) {}
+
+      LruCache(const LruCache& other) : capacity_(other.capacity_), entries_(other.entries_) { reindex(); }
+      LruCache& operator=(const LruCache& other) {
+        if (this != &other) {
+          capacity_ = other.capacity_;
+          entries_ = other.entries_;
+          reindex();
+        }
+        return *this;
+      }
+      LruCache(LruCache&&) noexcept = default;
+      LruCache& operator=(LruCache&&) noexcept = default;
+
+      // Marks the entry as most recently used. The pointer is valid until the
+      // next put() or clear().
+      const Value* find(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+      }
+
+      void put(Key key, Value value) {
+        if (capacity_ == 0) return;
+        if (auto it = index_.find(key); it != index_.end()) {
+          it->second->second = std::move(value);
+          entries_.splice(entries_.begin(), entries_, it->second);
+          return;
+        }
+        if (entries_.size() == capacity_) {
+          index_.erase(entries_.back().first);
+          entries_.pop_back();
+        }
+        entries_.emplace_front(key, std::move(value));
+        index_.emplace(std::move(key), entries_.begin());
+      }
+
+      void clear() {
+        entries_.clear();
+        index_.clear();
+      }
+
+      size_t size() const { return entries_.size(); }
+      size_t capacity() const { return capacity_; }
+
+    private:
+      using Entries = std::list<std::pair<Key, Value>>;
+
+      void reindex() {
+        index_.clear();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) index_.emplace(it->first, it);
+      }
+
+      size_t capacity_;
+      Entries entries_;  // most recently used first
+      std::unordered_map<Key, typename Entries::iterator> index_;
+  };
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <vector>
 #include <span>
 #include <cstdint>
@@ -17,6 +18,20 @@ namespace astro::core {
 
   Hash256 root(const std::vector<Hash256>& leaves);
 
+  // root() over leaves added one at a time, keeping one pending hash per
+  // tree level rather than the leaves themselves.
+  class MerkleAccumulator {
+    public:
+      void add(const Hash256& leaf);
+      Hash256 root() const;
+      uint64_t size() const { return count_; }
+
+    private:
+      // frontier_[level] is pending exactly when bit `level` of count_ is set.
+      std::array<Hash256, 64> frontier_{};
+      uint64_t count_ = 0;
+  };
+
   MerkleProof build_proof(const std::vector<Hash256>& leaves, size_t index);
 
   bool verify_proof(std::span<const uint8_t> leaf_hash, const MerkleProof& proof, const Hash256& expected_root);
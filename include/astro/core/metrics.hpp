@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Process-wide timing counters for the hot paths. Each thread records into
+// counters of its own, so recording never contends; snapshot() sums them.
+// Built with ASTRO_METRICS (the ASTRO_WITH_METRICS option); without it the
+// macros below expand to nothing and snapshot() is all zeros.
+namespace astro::core::metrics {
+#ifdef ASTRO_METRICS
+  inline constexpr bool enabled = true;
+#else
+  inline constexpr bool enabled = false;
+#endif
+
+  enum class Timer : uint8_t {
+    ValidateHeader,      // linkage, timestamp, PoW
+    ValidateStructure,   // coinbase rules, merkle root
+    ValidateSignatures,
+    StoreSerialize,      // encoding a batch of records
+    StoreWrite,          // with io_uring, write and fsync together
+    StoreFsync,
+    StoreLoad,           // one whole load_blocks() pass, sink included
+  };
+  inline constexpr size_t TIMER_COUNT = 7;
+
+  enum class Counter : uint8_t {
+    StoreBlocksAppended,
+    StoreBytesAppended,
+    StoreBlocksLoaded,
+    StorePruneFailures,    // compactions that threw; the next append retries
+    BlocksAccepted,        // appended to a chain; restores not included
+    TransactionsAccepted,
+    BodyCacheHits,         // paged chains' get_block()
+    BodyCacheMisses,
+    MineHashes,
+  };
+  inline constexpr size_t COUNTER_COUNT = 9;
+
+  // Dotted lowercase, e.g. "validate.header".
+  const char* name(Timer timer);
+  const char* name(Counter counter);
+
+  // Bucket b counts durations in [2^b, 2^(b+1)) ns; 0 ns lands in bucket 0
+  // and anything from 2^(BUCKETS-1) ns (about 9 minutes) up in the last.
+  inline constexpr size_t BUCKETS = 40;
+
+  struct Histogram {
+    uint64_t count = 0;
+    uint64_t total_nanos = 0;
+    std::array<uint64_t, BUCKETS> buckets{};
+
+    static size_t bucket_of(uint64_t nanos);
+    static uint64_t bucket_upper_nanos(size_t bucket) { return uint64_t{1} << (bucket + 1); }
+    // Upper bound of the bucket the q-quantile falls in; 0 when empty.
+    uint64_t quantile_nanos(double q) const;
+  };
+
+  struct Snapshot {
+    std::array<Histogram, TIMER_COUNT> timers{};
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+
+    const Histogram& operator[](Timer timer) const { return timers[static_cast<size_t>(timer)]; }
+    uint64_t operator[](Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+  };
+
+#ifdef ASTRO_METRICS
+  void record(Timer timer, uint64_t nanos);
+  void add(Counter counter, uint64_t value);
+#else
+  inline void record(Timer, uint64_t) {}
+  inline void add(Counter, uint64_t) {}
+#endif
+
+  // Everything recorded since the last reset(), by every thread, including
+  // threads that have since exited.
+  Snapshot snapshot();
+  void reset();
+
+  // `counter` for each live thread that has recorded anything, keyed by a
+  // number that tells threads apart for the life of the process, then under
+  // 0 whatever threads that have exited recorded. Not affected by reset().
+  std::vector<std::pair<uint32_t, uint64_t>> per_thread(Counter counter);
+
+  // Records the time until it goes out of scope.
+  class ScopedTimer {
+    public:
+      explicit ScopedTimer(Timer timer) : timer_(timer), start_(std::chrono::steady_clock::now()) {}
+      ~ScopedTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        record(timer_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+      }
+      ScopedTimer(const ScopedTimer&) = delete;
+      ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+      Timer timer_;
+      std::chrono::steady_clock::time_point start_;
+  };
+}
+
+#define ASTRO_METRICS_CONCAT_(a, b) a##b
+#define ASTRO_METRICS_CONCAT(a, b) ASTRO_METRICS_CONCAT_(a, b)
+#ifdef ASTRO_METRICS
+  #define ASTRO_METRICS_TIMER(timer) \
+    ::astro::core::metrics::ScopedTimer ASTRO_METRICS_CONCAT(astro_metrics_timer_, __LINE__)(timer)
+  #define ASTRO_METRICS_ADD(counter, value) ::astro::core::metrics::add(counter, value)
+#else
+  #define ASTRO_METRICS_TIMER(timer) static_cast<void>(0)
+  #define ASTRO_METRICS_ADD(counter, value) static_cast<void>(0)
+#endif
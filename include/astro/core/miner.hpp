@@ -12,4 +12,9 @@ namespace astro::core {
   Block mine_block(const Chain& chain, std::vector<Transaction> transactions, 
                   uint32_t difficulty_bits, std::atomic<bool>& cancel_flag,
                   MinerProgressCallback on_progress = nullptr, uint64_t tick_every_ms = 50000);
+
+  // Same, on a published view, so the chain can keep appending meanwhile.
+  Block mine_block(const ChainView& view, std::vector<Transaction> transactions,
+                  uint32_t difficulty_bits, std::atomic<bool>& cancel_flag,
+                  MinerProgressCallback on_progress = nullptr, uint64_t tick_every_ms = 50000);
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace astro::core {
+  // Unbounded multi-producer, single-consumer FIFO. push() is one atomic
+  // exchange and never waits on other producers; pop() and empty() may only
+  // be called from the one consumer thread. Items from a single producer come
+  // out in the order it pushed them.
+  template <class T>
+  class MpscQueue {
+    public:
+      MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+      ~MpscQueue() {
+        while (tail_) delete std::exchange(tail_, tail_->next.load(std::memory_order_relaxed));
+      }
+
+      MpscQueue(const MpscQueue&) = delete;
+      MpscQueue& operator=(const MpscQueue&) = delete;
+
+      void push(T value) {
+        auto* node = new Node;
+        node->value.emplace(std::move(value));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        // Until this store the consumer sees the queue end at `prev`.
+        prev->next.store(node, std::memory_order_release);
+      }
+
+      std::optional<T> pop() {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (!next) return std::nullopt;
+        std::optional<T> value = std::move(next->value);
+        next->value.reset();
+        delete std::exchange(tail_, next);  // `next` is the new stub
+        return value;
+      }
+
+      // False once a push has finished linking its item in.
+      bool empty() const { return tail_->next.load(std::memory_order_acquire) == nullptr; }
+
+    private:
+      struct Node {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+      };
+
+      std::atomic<Node*> head_;  // most recently pushed
+      Node* tail_;               // stub whose successor is the oldest item
+  };
+}
@@ -19,6 +19,15 @@ namespace astro::core {
       void write_u32(uint32_t value) { write_le_value(value); }
       void write_u64(uint64_t value) { write_le_value(value); }
 
+      // LEB128: 7 bits per byte, high bit set on all but the last.
+      void write_varint(uint64_t value) {
+        while (value >= 0x80) {
+          buffer_.push_back(static_cast<uint8_t>(value | 0x80));
+          value >>= 7;
+        }
+        buffer_.push_back(static_cast<uint8_t>(value));
+      }
+
       void write_raw(std::span<const uint8_t> bytes) {
         buffer_.insert(buffer_.end(), bytes.begin(), bytes.end());
       }
@@ -50,6 +59,17 @@ namespace astro::core {
       uint32_t read_u32() { return read_value<uint32_t>(); }
       uint64_t read_u64() { return read_value<uint64_t>(); }
 
+      uint64_t read_varint() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+          uint8_t byte = read_u8();
+          value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+          if (!(byte & 0x80)) return value;
+        }
+        ensure(false);
+        return 0;
+      }
+
       std::vector<uint8_t> read_bytes() {
         auto len = read_u32();
         ensure(len <= remaining_bytes());
@@ -58,6 +78,14 @@ namespace astro::core {
         return result;
       }
 
+      // View of the next `len` bytes; valid as long as the source buffer is.
+      std::span<const uint8_t> read_raw(size_t len) {
+        ensure(len <= remaining_bytes());
+        auto result = src_.subspan(pos_, len);
+        pos_ += len;
+        return result;
+      }
+
       std::string read_string() {
         auto len = read_u32();
         ensure(len <= remaining_bytes());
@@ -67,6 +95,7 @@ namespace astro::core {
       }
 
       size_t remaining_bytes() const { return src_.size() - pos_; }
+      size_t position() const { return pos_; }
     
     private:
       template <class T> T read_value() {
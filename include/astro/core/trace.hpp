@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Scoped spans for a timeline of where the node's time goes, written out as
+// Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev). Each thread
+// records into a fixed-size ring of its own, so recording takes no lock and
+// a busy thread keeps only its latest CAPACITY spans. Nothing is recorded
+// until start(). Built with ASTRO_TRACE (the ASTRO_WITH_TRACE option);
+// without it ASTRO_TRACE_SPAN expands to nothing.
+namespace astro::core::trace {
+#ifdef ASTRO_TRACE
+  inline constexpr bool compiled_in = true;
+#else
+  inline constexpr bool compiled_in = false;
+#endif
+
+  inline constexpr size_t CAPACITY = 16384;  // spans kept per thread
+
+  // Discards spans from earlier sessions and starts recording.
+  void start();
+  void stop();
+  bool active();
+
+  // Starts recording if ASTRO_TRACE is set in the environment and writes
+  // the trace to the file it names at exit. Returns whether it started.
+  bool start_from_env();
+
+  // Labels the calling thread's track. `name` must outlive the trace.
+  void set_thread_name(const char* name);
+
+  // Nanoseconds on the clock spans are stamped with.
+  uint64_t now_ns();
+  // A span from `start_ns` to `end_ns` on the calling thread; `name` must
+  // be a string literal or otherwise outlive the trace.
+  void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+  // Everything recorded this session, by every thread including those that
+  // have exited.
+  void write_json(std::ostream& out);
+  bool write_json_file(const std::string& path);
+
+  class Span {
+    public:
+      explicit Span(const char* name) : name_(active() ? name : nullptr), start_(name_ ? now_ns() : 0) {}
+      ~Span() {
+        if (name_) record(name_, start_, now_ns());
+      }
+      Span(const Span&) = delete;
+      Span& operator=(const Span&) = delete;
+
+    private:
+      const char* name_;
+      uint64_t start_;
+  };
+}
+
+#define ASTRO_TRACE_CONCAT_(a, b) a##b
+#define ASTRO_TRACE_CONCAT(a, b) ASTRO_TRACE_CONCAT_(a, b)
+#ifdef ASTRO_TRACE
+  #define ASTRO_TRACE_SPAN(name) ::astro::core::trace::Span ASTRO_TRACE_CONCAT(astro_trace_span_, __LINE__)(name)
+  #define ASTRO_TRACE_THREAD(name) ::astro::core::trace::set_thread_name(name)
+#else
+  #define ASTRO_TRACE_SPAN(name) static_cast<void>(0)
+  #define ASTRO_TRACE_THREAD(name) static_cast<void>(0)
+#endif
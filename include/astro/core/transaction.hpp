@@ -27,4 +27,7 @@ namespace astro::core {
   
  };
 
+ // Inverse of serialize(false); throws SerializeError on truncated input.
+ Transaction deserialize_transaction(std::span<const uint8_t> bytes);
+
 }
\ No newline at end of file
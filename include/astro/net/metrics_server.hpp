@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include "astro/core/chain.hpp"
+
+namespace astro::net {
+  struct MetricsServerOptions {
+    std::string host = "127.0.0.1";  // IPv4 address to bind
+    uint16_t port = 9464;            // 0 picks a free port
+  };
+
+  // Where the chain gauges come from: typically [&chain] { return chain.view(); }.
+  // Called on the server thread.
+  using ChainViewSource = std::function<std::shared_ptr<const astro::core::ChainView>()>;
+
+  // The Prometheus text exposition of astro::core::metrics, plus height and
+  // tip age from `view` when given.
+  std::string render_metrics(const astro::core::ChainView* view, uint64_t now_unix);
+
+  // Serves GET /metrics over plain HTTP/1.0 on a thread of its own, one
+  // connection at a time. Scrapes read the metrics snapshot and a chain view
+  // and never wait on the threads that record them.
+  class MetricsServer {
+    public:
+      // Binds and listens before returning; throws std::system_error if it
+      // can't.
+      explicit MetricsServer(MetricsServerOptions options = {}, ChainViewSource chain = {});
+      ~MetricsServer();
+
+      MetricsServer(const MetricsServer&) = delete;
+      MetricsServer& operator=(const MetricsServer&) = delete;
+
+      uint16_t port() const { return port_; }
+
+    private:
+      void run();
+      void serve(int client);
+
+      ChainViewSource chain_;
+      int listen_fd_ = -1;
+      uint16_t port_ = 0;
+      std::atomic<bool> stopping_{false};
+      std::thread thread_;
+  };
+}
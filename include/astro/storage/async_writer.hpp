@@ -0,0 +1,57 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <astro/core/block.hpp>
+#include <astro/storage/block_storage.hpp>
+
+namespace astro::storage {
+  // Persists blocks to a BlockStorage from a dedicated thread, in enqueue order.
+  // Whatever has queued up while a commit is in flight goes out as the next
+  // group commit (one write + one fsync for up to `max_batch` records).
+  //
+  // Each enqueue returns a future that becomes ready once the block is durable,
+  // or holds the store's exception if its commit failed. After a failure the
+  // writer refuses further work: every queued and later future fails with the
+  // same error, so nothing can be written out of order behind a gap.
+  class AsyncBlockWriter {
+    public:
+      explicit AsyncBlockWriter(BlockStorage& store, size_t max_batch = 256);
+      ~AsyncBlockWriter();
+
+      AsyncBlockWriter(const AsyncBlockWriter&) = delete;
+      AsyncBlockWriter& operator=(const AsyncBlockWriter&) = delete;
+
+      std::future<void> enqueue(astro::core::Block block);
+
+      // Block until everything enqueued so far has been committed or failed.
+      void flush();
+
+      bool failed() const;
+      uint64_t commits() const;
+
+    private:
+      struct Pending {
+        astro::core::Block block;
+        std::promise<void> durable;
+      };
+
+      void run();
+
+      BlockStorage& store_;
+      size_t max_batch_;
+      mutable std::mutex mu_;
+      std::condition_variable work_cv_;
+      std::condition_variable idle_cv_;
+      std::deque<Pending> queue_;
+      bool in_flight_ = false;
+      bool stopping_ = false;
+      std::exception_ptr error_;
+      uint64_t commits_ = 0;
+      std::thread thread_;
+  };
+}
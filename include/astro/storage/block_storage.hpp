@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <astro/core/block.hpp>
+
+namespace astro::storage {
+  // What Chain and AsyncBlockWriter need from a persistent block store.
+  // Implemented by BlockStore (flat chain.log) and, in builds with
+  // ASTRO_HAVE_ROCKSDB, RocksBlockStore. Appends throw on failure.
+  class BlockStorage {
+    public:
+      virtual ~BlockStorage() = default;
+
+      virtual void append_block(const astro::core::Block& block) = 0;
+
+      // All-or-nothing: on failure none of the batch is kept.
+      virtual void append_blocks(std::span<const astro::core::Block> blocks) = 0;
+
+      virtual std::vector<astro::core::Block> load_all_blocks() = 0;
+
+      // Streams the stored blocks in order to `sink` until it returns false.
+      // The default goes through load_all_blocks().
+      virtual void load_blocks(const std::function<bool(astro::core::Block&&)>& sink) {
+        for (auto& block : load_all_blocks()) {
+          if (!sink(std::move(block))) return;
+        }
+      }
+
+      // Transactions of the block at `height`, for callers that keep only
+      // headers in memory. Empty for a block stored as a header only. Throws
+      // std::out_of_range past the last record. The default streams from the
+      // start; stores with an index override it.
+      virtual std::vector<astro::core::Transaction> read_body(uint64_t height) {
+        std::vector<astro::core::Transaction> body;
+        uint64_t index = 0;
+        bool found = false;
+        load_blocks([&](astro::core::Block&& block) {
+          if (index++ < height) return true;
+          body = std::move(block.transactions);
+          found = true;
+          return false;
+        });
+        if (!found) throw std::out_of_range("BlockStorage: no block at that height");
+        return body;
+      }
+
+      virtual void clear() = 0;
+
+      virtual size_t record_count() const = 0;
+
+      // Drop the transaction bodies of blocks below `height`, keeping their
+      // headers. Storage may defer the work until it is worth doing; storage
+      // that can't prune ignores it.
+      virtual void prune_bodies(uint64_t height) { (void)height; }
+
+      // Leading blocks that load_all_blocks() returns as headers only.
+      virtual uint64_t pruned_height() const { return 0; }
+  };
+}
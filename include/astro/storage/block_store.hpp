@@ -1,8 +1,16 @@
 #pragma once
 #include <cstdint>
 #include <vector>
+#include <span>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
 #include <astro/core/block.hpp>
+#include <astro/storage/block_storage.hpp>
+#include <astro/storage/compression.hpp>
+#include <astro/storage/io_uring.hpp>
+#include <astro/storage/key_dictionary.hpp>
 
 namespace astro::storage {
   struct RecordHeader {
@@ -12,24 +20,122 @@ namespace astro::storage {
     uint64_t length;
   };
 
-  class BlockStore {
+  // Per-record corruption check. Sha256 records are format v1; Crc32c
+  // records are v2. Both can be read regardless of the write setting.
+  enum class RecordChecksum : uint8_t {
+    Sha256,
+    Crc32c,
+  };
+
+  struct BlockStoreOptions {
+    RecordChecksum checksum = RecordChecksum::Sha256;
+    // Route appends and bulk reads through io_uring. Only has an effect in
+    // builds with ASTRO_WITH_IO_URING, and only if the kernel allows it.
+    bool use_io_uring = true;
+    // Grow chain.log with fallocate in chunks of this many bytes, so an append
+    // only writes data and the file size doesn't change on every fsync. Zero
+    // disables preallocation; logs stay readable either way.
+    uint64_t preallocate_bytes = 4ull << 20;
+    // Write headers that extend the previous record without prev_hash (it is
+    // rebuilt and checked on load) and with varint/delta-coded integers.
+    bool compact_headers = false;
+    // Store each sender key once in keys.dict and refer to it by id from the
+    // transactions in chain.log. Loaded transactions are byte-identical.
+    bool key_dictionary = false;
+    // Compress each record payload of at least compress_min_bytes with this
+    // codec, keeping the result only if it saves an eighth or more.
+    Compression compression = Compression::None;
+    uint64_t compress_min_bytes = 256;
+    // prune_bodies() compacts the log only once at least this many bytes of
+    // bodies can be reclaimed; until then it just remembers the target.
+    uint64_t prune_compact_bytes = 1ull << 20;
+  };
+
+  // What the open-time recovery pass found. Only the tail past the last
+  // index checkpoint is re-read, so `scanned_records` stays small after a crash.
+  // A bad record with only zeros and fragments behind it is a torn append and
+  // is cut off; one with good records behind it makes the open throw.
+  struct RecoveryReport {
+    uint64_t records = 0;          // valid records in the log after recovery
+    uint64_t scanned_records = 0;  // records re-verified from the tail
+    uint64_t valid_bytes = 0;      // end offset of the last good record
+    uint64_t discarded_bytes = 0;  // torn suffix truncated from the log
+    uint64_t preallocated_bytes = 0; // zeroed space kept past valid_bytes
+    bool index_rebuilt = false;    // index was missing or stale; full scan done
+  };
+
+  class BlockStore : public BlockStorage {
     public:
-      explicit BlockStore(std::filesystem::path root_path);
-      ~BlockStore();
+      explicit BlockStore(std::filesystem::path root_path, BlockStoreOptions options = {});
+      ~BlockStore() override;
+
+      void append_block(const astro::core::Block& block) override;
+
+      // Group commit: all records go out in one write followed by one fsync.
+      // Throws on failure, in which case none of the batch is kept.
+      void append_blocks(std::span<const astro::core::Block> blocks) override;
+
+      std::vector<astro::core::Block> load_all_blocks() override;
+      // Throws std::runtime_error at a record that no longer checks out
+      // (recovery only re-verifies the tail), after the blocks before it.
+      void load_blocks(const std::function<bool(astro::core::Block&&)>& sink) override;
+      // One record read through the offset index.
+      std::vector<astro::core::Transaction> read_body(uint64_t height) override;
+
+      // Truncate the log and its index; the store is empty afterwards.
+      void clear() override;
+
+      size_t record_count() const override { return offsets_.size(); }
+
+      // Rewrites chain.log with the records below `height` reduced to headers;
+      // newer records are copied as they are. Atomic via a temp file + rename.
+      void prune_bodies(uint64_t height) override;
+      uint64_t pruned_height() const override { return header_only_; }
 
-      void append_block(const astro::core::Block& block);
+      const RecoveryReport& recovery() const { return recovery_; }
+      const BlockStoreOptions& options() const { return options_; }
+      bool io_uring_active() const { return ring_ != nullptr; }
 
-      std::vector<astro::core::Block> load_all_blocks();
+      // Logical end of the record data; the file itself may be longer.
+      uint64_t data_size() const { return end_offset_; }
+      uint64_t allocated_size() const { return allocated_; }
+      size_t key_count() const { return keys_.size(); }
 
       const std::filesystem::path& directory() const { return root_path_; }
       const std::filesystem::path& log_path() const { return log_path_; }
+      const std::filesystem::path& index_path() const { return index_path_; }
 
       private:
+        void recover();
+        void rewrite_index();
+        void append_index(std::span<const uint64_t> offsets);
         void open_write_log();
         void close_write_log();
-        void fsync_fd();
+        bool reserve(uint64_t end);
+        void write_at(std::span<const uint8_t> data, uint64_t offset);
+        void fsync_fd(bool data_only = false);
+        void read_range(std::span<uint8_t> out, uint64_t offset);
+        void compact(uint64_t height);
         std::filesystem::path root_path_;
+        BlockStoreOptions options_{};
         std::filesystem::path log_path_;
+        std::filesystem::path index_path_;
         int log_fd = -1;
+        std::vector<uint64_t> offsets_;  // start offset of each record
+        uint64_t end_offset_ = 0;
+        uint64_t allocated_ = 0;  // file size; everything past end_offset_ is zero
+        bool can_preallocate_ = true;
+        // Hash and timestamp of the last header written this session; compact
+        // records are only written after it, so the first one after open is full.
+        struct Link {
+          astro::core::Hash256 hash{};
+          uint64_t timestamp = 0;
+        };
+        std::optional<Link> link_;
+        KeyDictionary keys_;
+        uint64_t header_only_ = 0;  // leading records that hold headers only
+        RecoveryReport recovery_{};
+        std::unique_ptr<IoUring> ring_;
+        std::ifstream body_in_;  // opened on the first read_body()
   };
-}
\ No newline at end of file
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <astro/core/chain.hpp>
+
+namespace astro::storage {
+  // chain.snap, kept next to chain.log. Format: u32 magic "ASNP", u32 version,
+  // u64 count, then per block the serialized header and its hash, then (v2) a
+  // u8 tx-index flag and, if set, a u64 entry count and per entry the tx hash
+  // with varint height and index, then (v3) a u8 ledger flag and, if set,
+  // the Ledger, then a u32 CRC-32C of everything before it.
+  //
+  // Writes go to a temp file that is fsynced and renamed over the old one, so
+  // a crash leaves either the previous snapshot or the new one. A snapshot may
+  // run ahead of the log (Chain appends before the async writer persists);
+  // restore only trusts the blocks the log actually has.
+  void write_chain_snapshot(const std::filesystem::path& path, const astro::core::ChainSnapshot& snapshot);
+
+  // nullopt if the file is missing, truncated or fails its checksum.
+  std::optional<astro::core::ChainSnapshot> read_chain_snapshot(const std::filesystem::path& path);
+
+  // Writes snapshots from a dedicated thread so that taking one never waits
+  // on disk. Only the newest submitted snapshot is kept; older pending ones
+  // are dropped unwritten.
+  class SnapshotWriter {
+    public:
+      explicit SnapshotWriter(std::filesystem::path path);
+      // Writes whatever is still pending before returning.
+      ~SnapshotWriter();
+
+      SnapshotWriter(const SnapshotWriter&) = delete;
+      SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+      void submit(astro::core::ChainSnapshot snapshot);
+      // Builds the snapshot from `view` on the writer thread, so the caller
+      // only pays for copying `ledger`. No tx index is carried; restore
+      // rebuilds it by hashing.
+      void submit(std::shared_ptr<const astro::core::ChainView> view,
+                  std::optional<astro::core::Ledger> ledger = std::nullopt);
+
+      // Block until everything submitted so far is on disk. Rethrows the
+      // error of a failed write, once.
+      void flush();
+
+      uint64_t writes() const;
+
+    private:
+      void run();
+
+      std::filesystem::path path_;
+      mutable std::mutex mu_;
+      std::condition_variable work_cv_;
+      std::condition_variable idle_cv_;
+      // Either a snapshot or a view to build one from.
+      struct Pending {
+        std::optional<astro::core::ChainSnapshot> snapshot;
+        std::shared_ptr<const astro::core::ChainView> view;
+        std::optional<astro::core::Ledger> ledger;
+      };
+      std::optional<Pending> pending_;
+      bool in_flight_ = false;
+      bool stopping_ = false;
+      std::exception_ptr error_;
+      uint64_t writes_ = 0;
+      std::thread thread_;
+  };
+}
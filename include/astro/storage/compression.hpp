@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace astro::storage {
+  // Codecs for chain.log record payloads. The id is stored on disk.
+  enum class Compression : uint8_t {
+    None = 0,
+    Lz4 = 1,   // in-tree LZ4 block format codec; always available
+    Zstd = 2,  // only in builds with ASTRO_WITH_ZSTD
+  };
+
+  bool compression_available(Compression codec);
+
+  // Compresses `in` into `out`. Returns false, leaving `out` unspecified, when
+  // the codec isn't available or the result isn't smaller than the input.
+  bool compress(Compression codec, std::span<const uint8_t> in, std::vector<uint8_t>& out);
+
+  // Inverse of compress(); `raw_size` is the original length. Throws
+  // std::runtime_error on corrupt input or an unavailable codec.
+  void decompress(Compression codec, std::span<const uint8_t> in, size_t raw_size, std::vector<uint8_t>& out);
+
+  // The raw LZ4 block codec behind Compression::Lz4.
+  void lz4_compress(std::span<const uint8_t> in, std::vector<uint8_t>& out);
+  void lz4_decompress(std::span<const uint8_t> in, size_t raw_size, std::vector<uint8_t>& out);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace astro::storage {
+  // Minimal io_uring ring for BlockStore I/O, talking to the kernel directly
+  // (no liburing). Only built with ASTRO_WITH_IO_URING on Linux; elsewhere, or
+  // when the kernel refuses io_uring_setup, create() returns nullptr and the
+  // store keeps using blocking syscalls. Not thread-safe.
+  class IoUring {
+    public:
+      static std::unique_ptr<IoUring> create(unsigned entries = 64);
+      ~IoUring();
+
+      IoUring(const IoUring&) = delete;
+      IoUring& operator=(const IoUring&) = delete;
+
+      // Write `data` at `offset`, then fsync (fdatasync if `data_only`), as one
+      // linked submission. Short writes are resubmitted; throws
+      // std::system_error on failure.
+      void write_and_fsync(int fd, std::span<const uint8_t> data, uint64_t offset, bool data_only = false);
+
+      // Fill `out` from `offset` with up to depth() reads of `chunk` bytes in flight.
+      void read_exact(int fd, std::span<uint8_t> out, uint64_t offset, size_t chunk = 1 << 20);
+
+      unsigned depth() const;
+
+    private:
+      struct Ring;
+      explicit IoUring(std::unique_ptr<Ring> ring);
+      std::unique_ptr<Ring> ring_;
+  };
+}
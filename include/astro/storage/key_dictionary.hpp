@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace astro::storage {
+  // Append-only table of sender public keys, persisted next to chain.log so
+  // records can refer to a key by id instead of repeating its PEM. Id 0 is the
+  // empty key (coinbase); real keys are numbered from 1 in insertion order.
+  //
+  // File format: per entry u32 length, key bytes, u32 CRC-32C(key bytes).
+  // A torn or corrupt tail is truncated on open. New ids are only handed out
+  // as pending until commit() has made them durable; records that use them
+  // must be written after that.
+  class KeyDictionary {
+    public:
+      explicit KeyDictionary(std::filesystem::path path);
+
+      // Id for `key`, adding it as pending if it's new.
+      uint64_t intern(std::span<const uint8_t> key);
+      // Appends pending keys to the file and fsyncs. Throws on failure, in
+      // which case the pending keys are forgotten.
+      void commit();
+      void discard_pending();
+
+      // Throws std::runtime_error for an unknown id.
+      const std::vector<uint8_t>& at(uint64_t id) const;
+
+      size_t size() const { return keys_.size() - pending_; }
+      uint64_t discarded_bytes() const { return discarded_bytes_; }
+      const std::filesystem::path& path() const { return path_; }
+
+      // Removes the file and forgets every key.
+      void clear();
+
+    private:
+      void load();
+
+      std::filesystem::path path_;
+      std::vector<std::vector<uint8_t>> keys_;       // keys_[id - 1]
+      std::unordered_map<std::string, uint64_t> ids_;
+      size_t pending_ = 0;                           // trailing keys_ not yet on disk
+      uint64_t discarded_bytes_ = 0;
+  };
+}
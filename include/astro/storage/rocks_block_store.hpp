@@ -0,0 +1,52 @@
+#pragma once
+#ifdef ASTRO_HAVE_ROCKSDB
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+#include <astro/core/block.hpp>
+#include <astro/core/hash.hpp>
+#include <astro/storage/block_storage.hpp>
+
+namespace astro::storage {
+  struct TxLocation {
+    uint64_t height = 0;
+    uint32_t index = 0; // position within the block
+  };
+
+  // RocksDB-backed store with the same surface as BlockStore. Column families:
+  //   blocks      big-endian u64 height -> serialized block
+  //   hash_index  header hash           -> height
+  //   tx_index    tx hash               -> height, index in block
+  // Each append is one synced WriteBatch across all three.
+  class RocksBlockStore : public BlockStorage {
+    public:
+      explicit RocksBlockStore(std::filesystem::path root_path);
+      ~RocksBlockStore() override;
+
+      RocksBlockStore(const RocksBlockStore&) = delete;
+      RocksBlockStore& operator=(const RocksBlockStore&) = delete;
+
+      void append_block(const astro::core::Block& block) override;
+      void append_blocks(std::span<const astro::core::Block> blocks) override;
+      std::vector<astro::core::Block> load_all_blocks() override;
+      std::vector<astro::core::Transaction> read_body(uint64_t height) override;
+      void clear() override;
+      size_t record_count() const override { return count_; }
+
+      std::optional<astro::core::Block> read_block(uint64_t height) const;
+      std::optional<uint64_t> height_of(const astro::core::Hash256& header_hash) const;
+      std::optional<TxLocation> find_transaction(const astro::core::Hash256& tx_hash) const;
+
+      const std::filesystem::path& directory() const { return root_path_; }
+
+    private:
+      struct Impl;
+      std::filesystem::path root_path_;
+      std::unique_ptr<Impl> impl_;
+      uint64_t count_ = 0;
+  };
+}
+#endif
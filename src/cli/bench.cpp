@@ -0,0 +1,658 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "astro/core/block.hpp"
+#include "astro/core/block_stream.hpp"
+#include "astro/core/chain.hpp"
+#include "astro/core/chain_writer.hpp"
+#include "astro/core/crc32c.hpp"
+#include "astro/core/hash.hpp"
+#include "astro/core/keys.hpp"
+#include "astro/core/trace.hpp"
+#include "astro/core/transaction.hpp"
+#include "astro/storage/block_store.hpp"
+
+using namespace astro::core;
+namespace fs = std::filesystem;
+
+static void print_usage() {
+  std::printf(
+    "Astro benchmarks\n\n"
+    "Usage:\n"
+    "  astro-bench store-load   [--blocks N] [--txs N] [--rounds N] [--dir PATH]\n"
+    "  astro-bench store-append [--blocks N] [--txs N] [--dir PATH]\n"
+    "  astro-bench restore      [--blocks N] [--txs N] [--rounds N] [--dir PATH]\n"
+    "  astro-bench import       [--blocks N] [--txs N] [--dir PATH]\n"
+    "  astro-bench paged        [--blocks N] [--txs N] [--rounds N] [--dir PATH]\n"
+    "  astro-bench tx-lookup    [--blocks N] [--txs N] [--rounds N] [--dir PATH]\n"
+    "  astro-bench ledger       [--blocks N] [--txs N] [--rounds N] [--dir PATH]\n"
+    "  astro-bench writer       [--blocks N] [--txs N] [--dir PATH]\n"
+    "  astro-bench validate     [--blocks N] [--txs N] [--rounds N]\n"
+    "  astro-bench stream       [--txs N] [--rounds N]\n\n"
+    "Options:\n"
+    "  --blocks   Blocks in the synthetic chain (default: 2000)\n"
+    "  --txs      Signed transactions per block (default: 8)\n"
+    "  --rounds   Timed repetitions, best is reported (default: 5)\n"
+    "  --dir      Scratch directory (default: system temp dir)\n"
+  );
+}
+
+struct BenchArgs {
+  size_t blocks = 2000;
+  size_t txs = 8;
+  size_t rounds = 5;
+  fs::path dir = fs::temp_directory_path() / "astro_bench";
+};
+
+static bool parse_args(int argc, char** argv, BenchArgs& args) {
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&](const char* name) -> const char* {
+      std::string flag = std::string("--") + name;
+      if (arg == flag && i + 1 < argc) return argv[++i];
+      if (arg.rfind(flag + "=", 0) == 0) return argv[i] + flag.size() + 1;
+      return nullptr;
+    };
+    if (auto v = value("blocks")) args.blocks = std::stoull(v);
+    else if (auto v = value("txs")) args.txs = std::stoull(v);
+    else if (auto v = value("rounds")) args.rounds = std::stoull(v);
+    else if (auto v = value("dir")) args.dir = v;
+    else {
+      std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+  if (args.rounds == 0) args.rounds = 1;
+  return true;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// A linear chain of blocks with `txs` signed transactions each, from a handful of senders.
+static std::vector<Block> make_synthetic_chain(size_t blocks, size_t txs) {
+  std::vector<KeyPair> senders;
+  for (int i = 0; i < 4; ++i) senders.push_back(generate_ec_keypair());
+
+  std::vector<Block> chain;
+  chain.reserve(blocks);
+  chain.push_back(make_genesis_block("bench", 1700000000ULL));
+  for (size_t h = 1; h < blocks; ++h) {
+    Block block;
+    for (size_t i = 0; i < txs; ++i) {
+      const auto& kp = senders[(h + i) % senders.size()];
+      Transaction tx;
+      tx.nonce = h * txs + i;
+      tx.amount = (h * 7 + i) % 1000;
+      tx.from_pub_pem = kp.pubkey_pem;
+      tx.to_label = "recipient-" + std::to_string(i % 16);
+      tx.sign(kp.privkey_pem);
+      block.transactions.push_back(std::move(tx));
+    }
+    block.header.prev_hash = chain.back().header.hash();
+    block.header.merkle_root = compute_merkle_root(block.transactions);
+    block.header.timestamp = 1700000000ULL + h;
+    chain.push_back(std::move(block));
+  }
+  return chain;
+}
+
+// Blocking I/O always; io_uring too when this build and kernel support it.
+static std::vector<bool> io_backends(const fs::path& scratch) {
+  auto dir = scratch / "probe";
+  bool ring = false;
+  {
+    astro::storage::BlockStore probe(dir, astro::storage::BlockStoreOptions{.use_io_uring = true});
+    ring = probe.io_uring_active();
+  }
+  fs::remove_all(dir);
+  if (ring) return {false, true};
+  return {false};
+}
+
+static int bench_store_load(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+  using astro::storage::BlockStoreOptions;
+  using astro::storage::RecordChecksum;
+  using astro::storage::Compression;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+
+  // Checksum cost alone, over the same payload bytes the store writes.
+  std::vector<std::vector<uint8_t>> payloads;
+  size_t payload_bytes = 0;
+  for (const auto& block : blocks) {
+    payloads.push_back(block.serialize());
+    payload_bytes += payloads.back().size();
+  }
+  auto time_checksum = [&](auto&& fn) {
+    double best = 1e30;
+    for (size_t r = 0; r < args.rounds; ++r) {
+      auto t0 = std::chrono::steady_clock::now();
+      uint32_t sink = 0;
+      for (const auto& p : payloads) sink ^= fn(std::span<const uint8_t>(p.data(), p.size()));
+      double dt = seconds_since(t0);
+      if (sink == 0x12345678u) std::printf(" ");
+      if (dt < best) best = dt;
+    }
+    return payload_bytes / 1048576.0 / best;
+  };
+  std::printf("checksum only: sha256 %.0f MiB/s  crc32c %.0f MiB/s (%s)  crc32c-sw %.0f MiB/s\n",
+              time_checksum([](std::span<const uint8_t> p) { return uint32_t(sha256(p)[0]); }),
+              time_checksum([](std::span<const uint8_t> p) { return crc32c(p); }),
+              crc32c_hardware_available() ? "sse4.2" : "software",
+              time_checksum([](std::span<const uint8_t> p) { return crc32c_software(p); }));
+
+  struct Variant {
+    std::string name; RecordChecksum checksum; bool io_uring; bool compact = false; bool key_dictionary = false;
+    Compression compression = Compression::None;
+  };
+  std::vector<Variant> variants;
+  for (bool ring : io_backends(args.dir)) {
+    const std::string io = ring ? " io_uring" : " blocking";
+    variants.push_back({"sha256 (v1)" + io, RecordChecksum::Sha256, ring});
+    variants.push_back({"crc32c (v2)" + io, RecordChecksum::Crc32c, ring});
+    variants.push_back({"crc32c compact" + io, RecordChecksum::Crc32c, ring, true});
+    variants.push_back({"crc32c keydict" + io, RecordChecksum::Crc32c, ring, false, true});
+    variants.push_back({"crc32c compact+keydict" + io, RecordChecksum::Crc32c, ring, true, true});
+    variants.push_back({"crc32c lz4" + io, RecordChecksum::Crc32c, ring, false, false, Compression::Lz4});
+    variants.push_back({"crc32c compact+keydict+lz4" + io, RecordChecksum::Crc32c, ring, true, true, Compression::Lz4});
+    if (astro::storage::compression_available(Compression::Zstd)) {
+      variants.push_back({"crc32c zstd" + io, RecordChecksum::Crc32c, ring, false, false, Compression::Zstd});
+    }
+  }
+
+  for (const auto& variant : variants) {
+    auto dir = args.dir / "store-load";
+    fs::remove_all(dir);
+    {
+      BlockStore store(dir, BlockStoreOptions{.checksum = variant.checksum, .compact_headers = variant.compact,
+                                              .key_dictionary = variant.key_dictionary,
+                                              .compression = variant.compression});
+      store.append_blocks(blocks);
+    }
+    const auto bytes = BlockStore(dir).data_size();
+
+    double best = 1e30;
+    for (size_t r = 0; r < args.rounds; ++r) {
+      auto t0 = std::chrono::steady_clock::now();
+      BlockStore store(dir, BlockStoreOptions{.use_io_uring = variant.io_uring});
+      auto loaded = store.load_all_blocks();
+      double dt = seconds_since(t0);
+      if (loaded.size() != blocks.size()) {
+        std::fprintf(stderr, "%s: loaded %zu of %zu blocks\n", variant.name.c_str(), loaded.size(), blocks.size());
+        return 1;
+      }
+      if (dt < best) best = dt;
+    }
+    std::printf("%-36s log=%.2f MiB  load=%.2f ms  %.1f MiB/s  %.0f blocks/s\n",
+                variant.name.c_str(), bytes / 1048576.0, best * 1e3,
+                bytes / 1048576.0 / best, blocks.size() / best);
+    fs::remove_all(dir);
+  }
+  return 0;
+}
+
+// Latency of individual append_block calls (serialize + write + fsync).
+static int bench_store_append(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+  using astro::storage::BlockStoreOptions;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+
+  struct Variant { bool io_uring; uint64_t preallocate; };
+  std::vector<Variant> variants;
+  for (bool ring : io_backends(args.dir)) {
+    variants.push_back({ring, 0});
+    variants.push_back({ring, BlockStoreOptions{}.preallocate_bytes});
+  }
+
+  for (const auto& variant : variants) {
+    auto dir = args.dir / "store-append";
+    fs::remove_all(dir);
+    std::vector<double> micros;
+    micros.reserve(blocks.size());
+    double total = 0;
+    {
+      BlockStore store(dir, BlockStoreOptions{.use_io_uring = variant.io_uring,
+                                              .preallocate_bytes = variant.preallocate});
+      for (const auto& block : blocks) {
+        auto t0 = std::chrono::steady_clock::now();
+        store.append_block(block);
+        double dt = seconds_since(t0);
+        micros.push_back(dt * 1e6);
+        total += dt;
+      }
+    }
+    fs::remove_all(dir);
+
+    std::sort(micros.begin(), micros.end());
+    auto pct = [&](double p) { return micros[std::min(micros.size() - 1, static_cast<size_t>(p * micros.size()))]; };
+    std::printf("%-9s %-10s appends=%zu  p50=%.0f us  p90=%.0f us  p99=%.0f us  max=%.0f us  %.0f appends/s\n",
+                variant.io_uring ? "io_uring" : "blocking", variant.preallocate ? "prealloc" : "grow",
+                micros.size(), pct(0.50), pct(0.90), pct(0.99), micros.back(), micros.size() / total);
+  }
+  return 0;
+}
+
+// Chain::restore_from_store against a plain load-then-append_block loop.
+static int bench_restore(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+  auto dir = args.dir / "restore";
+  fs::remove_all(dir);
+  BlockStore store(dir);
+  store.append_blocks(blocks);
+
+  auto best_of = [&](auto&& restore) {
+    double best = 1e300;
+    for (size_t round = 0; round < args.rounds; ++round) {
+      auto t0 = std::chrono::steady_clock::now();
+      size_t height = restore();
+      best = std::min(best, seconds_since(t0));
+      if (height != blocks.size()) std::fprintf(stderr, "restored %zu of %zu blocks\n", height, blocks.size());
+    }
+    return best;
+  };
+
+  double sequential = best_of([&] {
+    Chain chain;
+    for (const auto& block : store.load_all_blocks()) {
+      if (!chain.append_block(block).is_valid) break;
+    }
+    return chain.height();
+  });
+  std::printf("%-12s %8.1f ms  %8.0f blocks/s\n", "sequential", sequential * 1e3, blocks.size() / sequential);
+
+  std::vector<size_t> thread_counts{1, 2, 4};
+  const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  if (std::find(thread_counts.begin(), thread_counts.end(), cores) == thread_counts.end()) thread_counts.push_back(cores);
+  for (size_t threads : thread_counts) {
+    double t = best_of([&] {
+      Chain chain(ChainConfig{.restore_threads = threads});
+      chain.restore_from_store(store);
+      return chain.height();
+    });
+    std::printf("pipeline x%-2zu %8.1f ms  %8.0f blocks/s  %.2fx\n", threads, t * 1e3, blocks.size() / t, sequential / t);
+  }
+
+  // Checkpoint at the tip: structural checks only.
+  double assumed = best_of([&] {
+    Chain chain(ChainConfig{.assume_valid_hash = blocks.back().header.hash()});
+    chain.restore_from_store(store);
+    return chain.height();
+  });
+  std::printf("%-12s %8.1f ms  %8.0f blocks/s  %.2fx\n", "assume-valid", assumed * 1e3, blocks.size() / assumed, sequential / assumed);
+
+  // Snapshot covering the whole log: header comparison only.
+  ChainSnapshot snapshot;
+  for (const auto& block : blocks) {
+    snapshot.headers.push_back(block.header);
+    snapshot.hashes.push_back(block.header.hash());
+  }
+  double snapshotted = best_of([&] {
+    Chain chain;
+    chain.restore_from_store(store, &snapshot);
+    return chain.height();
+  });
+  std::printf("%-12s %8.1f ms  %8.0f blocks/s  %.2fx\n", "snapshot", snapshotted * 1e3, blocks.size() / snapshotted, sequential / snapshotted);
+  fs::remove_all(dir);
+  return 0;
+}
+
+// Bulk import: one append_and_store per block against append_blocks batches.
+static int bench_import(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+  auto dir = args.dir / "import";
+
+  for (size_t batch : {size_t{1}, size_t{16}, size_t{256}}) {
+    fs::remove_all(dir);
+    BlockStore store(dir);
+    Chain chain;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < blocks.size(); i += batch) {
+      auto span = std::span<const Block>(blocks).subspan(i, std::min(batch, blocks.size() - i));
+      size_t appended = batch == 1 ? chain.append_and_store(span[0], store).is_valid
+                                   : chain.append_blocks(span, store).appended;
+      if (appended != span.size()) {
+        std::fprintf(stderr, "import stopped at block %zu\n", i + appended);
+        return 1;
+      }
+    }
+    double t = seconds_since(t0);
+    const std::string label = batch == 1 ? "append_and_store" : "append_blocks/" + std::to_string(batch);
+    std::printf("%-18s %8.1f ms  %8.0f blocks/s\n", label.c_str(), t * 1e3, blocks.size() / t);
+  }
+  fs::remove_all(dir);
+  return 0;
+}
+
+// Resident body bytes and get_block() cost for a fully resident chain and a
+// paged one, over uniformly random heights.
+static int bench_paged(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+  auto dir = args.dir / "paged";
+  fs::remove_all(dir);
+  BlockStore store(dir);
+  store.append_blocks(blocks);
+
+  const ChainConfig config{.assume_valid_hash = blocks.back().header.hash()};
+  Chain resident(config);
+  resident.restore_from_store(store);
+  std::vector<size_t> heights(20000);
+  uint64_t seed = 0x9E3779B97F4A7C15ULL;
+  for (auto& h : heights) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    h = static_cast<size_t>((seed >> 33) % blocks.size());
+  }
+
+  for (size_t cache : {size_t{0}, size_t{64}, blocks.size()}) {
+    ChainConfig paged_config = config;
+    paged_config.body_cache_blocks = cache;
+    Chain* chain = &resident;
+    std::unique_ptr<Chain> paged;
+    if (cache > 0) {
+      paged = std::make_unique<Chain>(paged_config, store);
+      paged->restore_from_store(store);
+      chain = paged.get();
+    }
+    double best = 1e300;
+    volatile size_t txs = 0;
+    for (size_t round = 0; round < args.rounds; ++round) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (size_t h : heights) txs = txs + chain->get_block(h)->transactions.size();
+      best = std::min(best, seconds_since(t0));
+    }
+    const std::string label = cache == 0 ? "resident" : "paged/" + std::to_string(cache);
+    std::printf("%-12s bodies=%8.2f MiB  get_block=%6.2f us\n", label.c_str(),
+                chain->retained_body_bytes() / (1024.0 * 1024.0), best * 1e6 / heights.size());
+  }
+  fs::remove_all(dir);
+  return 0;
+}
+
+// Transaction lookup by hash: scanning the chain against the tx index, and
+// what keeping the index costs on restore.
+static int bench_tx_lookup(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+  auto dir = args.dir / "tx-lookup";
+  fs::remove_all(dir);
+  BlockStore store(dir);
+  store.append_blocks(blocks);
+
+  std::vector<Hash256> targets;
+  uint64_t seed = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < 20000; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const auto& block = blocks[(seed >> 33) % blocks.size()];
+    targets.push_back(block.transactions[(seed >> 13) % block.transactions.size()].tx_hash());
+  }
+
+  const ChainConfig plain_config{.assume_valid_hash = blocks.back().header.hash()};
+  ChainConfig indexed_config = plain_config;
+  indexed_config.index_transactions = true;
+  Chain plain(plain_config);
+  Chain indexed(indexed_config);
+  double restore_plain = 1e300, restore_indexed = 1e300;
+  for (size_t round = 0; round < args.rounds; ++round) {
+    plain = Chain(plain_config);
+    auto t0 = std::chrono::steady_clock::now();
+    plain.restore_from_store(store);
+    restore_plain = std::min(restore_plain, seconds_since(t0));
+    indexed = Chain(indexed_config);
+    t0 = std::chrono::steady_clock::now();
+    indexed.restore_from_store(store);
+    restore_indexed = std::min(restore_indexed, seconds_since(t0));
+  }
+  std::printf("%-12s restore=%8.1f ms\n", "no index", restore_plain * 1e3);
+  std::printf("%-12s restore=%8.1f ms\n", "tx index", restore_indexed * 1e3);
+
+  // The scan hashes every transaction up to the match, as a caller without
+  // the index would have to.
+  const size_t scanned = std::min<size_t>(targets.size(), 200);
+  auto t0 = std::chrono::steady_clock::now();
+  volatile size_t found = 0;
+  for (size_t i = 0; i < scanned; ++i) {
+    bool hit = false;
+    for (size_t h = 0; h < plain.height() && !hit; ++h) {
+      for (const auto& tx : plain.block_at(h)->transactions) {
+        if (tx.tx_hash() == targets[i]) {
+          hit = true;
+          break;
+        }
+      }
+    }
+    found = found + hit;
+  }
+  const double scan = seconds_since(t0) / scanned;
+  std::printf("%-12s lookup=%10.2f us\n", "scan", scan * 1e6);
+
+  double best = 1e300;
+  for (size_t round = 0; round < args.rounds; ++round) {
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& target : targets) found = found + indexed.find_transaction(target)->proof.has_value();
+    best = std::min(best, seconds_since(t0));
+  }
+  const double lookup = best / targets.size();
+  std::printf("%-12s lookup=%10.2f us  %.0fx (includes the merkle proof)\n", "tx index", lookup * 1e6, scan / lookup);
+  fs::remove_all(dir);
+  return 0;
+}
+
+// Restore with the ledger off, rebuilt from the bodies, and taken from a
+// snapshot.
+static int bench_ledger(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+  auto dir = args.dir / "ledger";
+  fs::remove_all(dir);
+  BlockStore store(dir);
+  store.append_blocks(blocks);
+
+  const ChainConfig plain_config{.assume_valid_hash = blocks.back().header.hash()};
+  ChainConfig ledger_config = plain_config;
+  ledger_config.track_ledger = true;
+  Chain source(ledger_config);
+  source.restore_from_store(store);
+  const auto snapshot = source.snapshot();
+
+  auto best_of = [&](const ChainConfig& config, const ChainSnapshot* from) {
+    double best = 1e300;
+    for (size_t round = 0; round < args.rounds; ++round) {
+      Chain chain(config);
+      auto t0 = std::chrono::steady_clock::now();
+      chain.restore_from_store(store, from);
+      best = std::min(best, seconds_since(t0));
+    }
+    return best;
+  };
+  std::printf("%-16s restore=%8.1f ms\n", "no ledger", best_of(plain_config, nullptr) * 1e3);
+  std::printf("%-16s restore=%8.1f ms\n", "ledger rebuilt", best_of(ledger_config, nullptr) * 1e3);
+  std::printf("%-16s restore=%8.1f ms\n", "no ledger+snap", best_of(plain_config, &snapshot) * 1e3);
+  std::printf("%-16s restore=%8.1f ms  senders=%zu recipients=%zu\n", "ledger+snap", best_of(ledger_config, &snapshot) * 1e3,
+              source.ledger()->sender_count(), source.ledger()->recipient_count());
+  fs::remove_all(dir);
+  return 0;
+}
+
+// Producers handing blocks to a ChainWriter against one thread calling
+// append_and_store per block.
+static int bench_writer(const BenchArgs& args) {
+  using astro::storage::BlockStore;
+
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+  auto dir = args.dir / "writer";
+  auto report = [&](const char* label, double t) {
+    std::printf("%-22s %8.1f ms  %8.0f blocks/s\n", label, t * 1e3, blocks.size() / t);
+  };
+
+  {
+    fs::remove_all(dir);
+    BlockStore store(dir);
+    Chain chain;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& block : blocks) {
+      if (!chain.append_and_store(block, store).is_valid) return 1;
+    }
+    report("append_and_store", seconds_since(t0));
+  }
+
+  // One producer waiting on each result, then one keeping them all in
+  // flight so the writer can batch.
+  for (bool pipelined : {false, true}) {
+    fs::remove_all(dir);
+    BlockStore store(dir);
+    ChainWriter writer(Chain{}, store);
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::future<ValidationResult>> results;
+    for (const auto& block : blocks) {
+      results.push_back(writer.submit(block));
+      if (!pipelined && !results.back().get().is_valid) return 1;
+    }
+    if (pipelined) {
+      for (auto& result : results) {
+        if (!result.get().is_valid) return 1;
+      }
+    }
+    const double t = seconds_since(t0);
+    report(pipelined ? "writer, pipelined" : "writer, one at a time", t);
+    std::printf("%-22s %8llu commits\n", "", static_cast<unsigned long long>(writer.commits()));
+  }
+  fs::remove_all(dir);
+  return 0;
+}
+
+// Where validate_block's time goes over the synthetic chain, and what a
+// block with too little work costs to turn away.
+static int bench_validate(const BenchArgs& args) {
+  std::printf("building synthetic chain: %zu blocks x %zu txs\n", args.blocks, args.txs);
+  auto blocks = make_synthetic_chain(args.blocks, args.txs);
+
+  Chain chain;
+  for (const auto& block : blocks) {
+    if (!chain.append_block(block).is_valid) return 1;
+  }
+  auto report = [&](const char* label, const ValidationStats::Stage& stage) {
+    std::printf("%-12s %8.1f ms  %8.2f us/run  %zu runs\n", label, stage.nanos / 1e6,
+                stage.runs ? stage.nanos / 1e3 / stage.runs : 0.0, static_cast<size_t>(stage.runs));
+  };
+  report("header", chain.validation_stats().header);
+  report("structure", chain.validation_stats().structure);
+  report("signatures", chain.validation_stats().signatures);
+
+  // The synthetic blocks are unmined, so at 24 bits any of them fails PoW.
+  Chain bare;
+  bare.append_block(blocks.front());
+  for (uint32_t bits : {0u, 24u}) {
+    bare.set_difficulty_bits(bits);
+    const size_t tries = args.rounds * (bits ? 1000 : 10);
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tries; ++i) {
+      if (bare.validate_block(blocks[1]).is_valid != (bits == 0)) return 1;
+    }
+    std::printf("%-12s %8.2f us/block\n", bits ? "bad PoW" : "valid", seconds_since(t0) * 1e6 / tries);
+  }
+  return 0;
+}
+
+// One block of --txs transactions arriving as serialized bytes: decoded
+// then validated, against checked as it streams in 16 KiB pieces.
+static int bench_stream(const BenchArgs& args) {
+  auto blocks = make_synthetic_chain(2, args.txs);
+  Chain chain;
+  if (!chain.append_block(blocks[0]).is_valid) return 1;
+  const auto bytes = blocks[1].serialize();
+  std::printf("block: %zu txs, %zu bytes\n", args.txs, bytes.size());
+  constexpr size_t PIECE = 16 << 10;
+  const size_t threads = std::max(2u, std::thread::hardware_concurrency());
+
+  auto best_of = [&](const char* label, auto&& validate) {
+    double best = 1e30;
+    for (size_t r = 0; r < args.rounds; ++r) {
+      auto t0 = std::chrono::steady_clock::now();
+      if (!validate()) return false;
+      best = std::min(best, seconds_since(t0));
+    }
+    std::printf("%-22s %8.2f ms\n", label, best * 1e3);
+    return true;
+  };
+  auto streamed = [&](const std::vector<uint8_t>& input, size_t verify_threads) {
+    BlockStreamValidator validator(chain, {}, verify_threads);
+    for (size_t at = 0; at < input.size(); at += PIECE) {
+      if (!validator.feed(std::span<const uint8_t>(input).subspan(at, std::min(PIECE, input.size() - at)))) break;
+    }
+    return validator.finish();
+  };
+
+  bool ok = best_of("decode + validate", [&] { return chain.validate_block(deserialize_block(bytes)).is_valid; });
+  ok = ok && best_of("stream, inline", [&] { return streamed(bytes, 0).is_valid; });
+  ok = ok && best_of(("stream, " + std::to_string(threads) + " verifiers").c_str(),
+                     [&] { return streamed(bytes, threads).is_valid; });
+
+  // A bad signature on the first transaction.
+  auto bad = blocks[1];
+  bad.transactions[0].signature[5] ^= 0x01;
+  bad.header.merkle_root = compute_merkle_root(bad.transactions);
+  const auto bad_bytes = bad.serialize();
+  ok = ok && best_of("reject, decode first", [&] { return !chain.validate_block(deserialize_block(bad_bytes)).is_valid; });
+  ok = ok && best_of("reject, streamed", [&] { return !streamed(bad_bytes, 0).is_valid; });
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    print_usage();
+    return 0;
+  }
+  const std::string command = argv[1];
+  BenchArgs args;
+  if (!parse_args(argc, argv, args)) {
+    print_usage();
+    return 1;
+  }
+  if (!crypto_init()) {
+    std::fprintf(stderr, "crypto_init failed\n");
+    return 1;
+  }
+  // ASTRO_TRACE=path.json records a timeline of the run.
+  trace::start_from_env();
+
+  if (command == "store-load") return bench_store_load(args);
+  if (command == "store-append") return bench_store_append(args);
+  if (command == "restore") return bench_restore(args);
+  if (command == "import") return bench_import(args);
+  if (command == "paged") return bench_paged(args);
+  if (command == "tx-lookup") return bench_tx_lookup(args);
+  if (command == "ledger") return bench_ledger(args);
+  if (command == "writer") return bench_writer(args);
+  if (command == "validate") return bench_validate(args);
+  if (command == "stream") return bench_stream(args);
+
+  print_usage();
+  return 1;
+}
@@ -6,11 +6,13 @@
 #include "astro/core/miner.hpp"
 #include "astro/core/keys.hpp"
 #include "astro/core/hash.hpp"
+#include "astro/core/trace.hpp"
 
 using namespace astro::core;
 
 int main(int argc, char** argv) {
   if (!crypto_init()) { std::cerr << "OpenSSL init failed" << std::endl; return 1; }
+  trace::start_from_env();
 
   uint32_t difficulty_bits = 18;
 
@@ -3,21 +3,32 @@
 #include <span>
 
 #include "astro/storage/block_store.hpp"
+#include "astro/storage/chain_snapshot.hpp"
 #include "astro/core/chain.hpp"
 #include "astro/core/keys.hpp"
 #include "astro/core/hash.hpp"
+#include "astro/core/trace.hpp"
 
 using namespace astro::core;
 namespace fs = std::filesystem;
 
 int main() {
   if (!crypto_init()) { std::cerr << "OpenSSL init failed\n"; return 1; }
+  trace::start_from_env();
 
   fs::path data = "./data";
   astro::storage::BlockStore store(data);
 
+  const auto& recovery = store.recovery();
+  if (recovery.discarded_bytes > 0) {
+    std::cout << "[!] recovery: truncated " << recovery.discarded_bytes << " torn bytes after "
+              << recovery.records << " records\n";
+  }
+
+  const fs::path snapshot_path = data / "chain.snap";
+  auto snapshot = astro::storage::read_chain_snapshot(snapshot_path);
   Chain chain(ChainConfig{.difficulty_bits=0});
-  chain.restore_from_store(store);
+  chain.restore_from_store(store, snapshot ? &*snapshot : nullptr);
   std::cout << "[💾] restored height: " << chain.height() << "\n";
 
   if (chain.height() == 0) {
@@ -33,6 +44,8 @@ int main() {
     std::cout << (validation_result.is_valid ? "[+] appended block\n" : "[x] append failed\n");
   }
 
+  astro::storage::write_chain_snapshot(snapshot_path, chain.snapshot());
+
   auto tip_hash = chain.tip_hash();
   if (tip_hash) {
     std::cout << "tip: " << to_hex(std::span<const uint8_t>(tip_hash->data(), tip_hash->size())).substr(0,16) << "...\n";
@@ -12,19 +12,23 @@
 #include <mutex>
 #include <cmath>
 #include <vector>
+#include <future>
 #include <termios.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <filesystem>
 #include <ctime>
-#include <fstream>
 
 #include "astro/core/chain.hpp"
 #include "astro/core/keys.hpp"
 #include "astro/core/hash.hpp"
 #include "astro/core/block.hpp"
 #include "astro/core/miner.hpp"
+#include "astro/core/trace.hpp"
+#include "astro/net/metrics_server.hpp"
 #include "astro/storage/block_store.hpp"
+#include "astro/storage/async_writer.hpp"
+#include "astro/storage/chain_snapshot.hpp"
 
 using namespace astro::core;
 
@@ -169,8 +173,12 @@ struct MiningState {
 };
 
 struct App {
-  Chain chain;
+  Chain chain{ChainConfig{.track_ledger = true}};
   astro::storage::BlockStore store{std::filesystem::path("./data")};
+  astro::storage::AsyncBlockWriter writer{store};
+  astro::storage::SnapshotWriter snapshots{std::filesystem::path("./data/chain.snap")};
+  // Height of each block on its way to the store, with its write.
+  std::vector<std::pair<size_t, std::future<void>>> pending_writes;
   uint32_t ui_difficulty_bits = 16;
   std::vector<LogLine> log;
   size_t max_log = 200;
@@ -210,6 +218,43 @@ static uint64_t now_sec() {
       std::chrono::system_clock::now().time_since_epoch()).count());
 }
 
+// Blocks between background chain snapshots; one is also taken on exit.
+static constexpr size_t SNAPSHOT_INTERVAL = 64;
+
+// Headers come from the published view on the snapshot thread, so only the
+// ledger is copied here.
+static void submit_snapshot(App& app) {
+  const Ledger* ledger = app.chain.ledger();
+  app.snapshots.submit(app.chain.view(), ledger ? std::optional<Ledger>(*ledger) : std::nullopt);
+}
+
+// Appends in memory immediately; the write + fsync happen on the writer thread.
+static ValidationResult append_async(App& app, const Block& block) {
+  auto result = app.chain.append_and_store_async(block, app.writer);
+  if (result.validation.is_valid) {
+    app.pending_writes.emplace_back(app.chain.height() - 1, std::move(result.durable));
+    if (app.chain.height() % SNAPSHOT_INTERVAL == 0) submit_snapshot(app);
+  }
+  return result.validation;
+}
+
+static void poll_writes(App& app) {
+  auto& pending = app.pending_writes;
+  size_t done = 0;
+  while (done < pending.size() &&
+         pending[done].second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    try {
+      pending[done].second.get();
+      app.chain.mark_durable(pending[done].first + 1);
+    } catch (const std::exception& ex) {
+      app.push_log(std::string("store write failed: ") + ex.what(), 31);
+      app.toast("Store write failed", 31, 5.0);
+    }
+    ++done;
+  }
+  pending.erase(pending.begin(), pending.begin() + done);
+}
+
 static bool do_genesis(App& app) {
   if (app.chain.height() > 0) {
     app.push_log("genesis already exists", 33);
@@ -218,7 +263,7 @@ static bool do_genesis(App& app) {
   tui::drain_input();
   uint64_t unix_time = now_sec();
   Block genesis_block = make_genesis_block("Astro: Born from bytes.", unix_time);
-  auto validation_result = app.chain.append_and_store(genesis_block, app.store);
+  auto validation_result = append_async(app, genesis_block);
   if (validation_result.is_valid) {
     app.push_log("genesis appended ✓", 32);
     app.toast("Genesis created", 32, 4.0);
@@ -246,7 +291,7 @@ static bool do_append_signed_block(App& app) {
 
   uint64_t unix_time = now_sec();
   Block new_block = app.chain.build_block_from_transactions({transaction}, unix_time);
-  auto validation_result = app.chain.append_and_store(new_block, app.store);
+  auto validation_result = append_async(app, new_block);
   if (validation_result.is_valid) { app.push_log("block appended ✓", 32); app.toast("Block appended", 32, 4.0); return true; }
   app.push_log("append failed (validation error)", 31);
   app.toast("Append failed", 31, 4.0);
@@ -299,10 +344,13 @@ static void start_mining(App& app) {
   std::vector<Transaction> txs{tx};
 
   uint32_t difficulty = app.ui_difficulty_bits;
-  const Chain* chain_ptr = &app.chain;
+  // The worker builds on a view of the chain, not the chain itself, which
+  // this thread keeps appending to.
+  auto view = app.chain.view();
   MiningState* ms = &app.mining;
 
-  ms->worker = std::thread([chain_ptr, ms, difficulty, txs]() mutable {
+  ms->worker = std::thread([view, ms, difficulty, txs]() mutable {
+    ASTRO_TRACE_THREAD("miner");
     auto t0 = std::chrono::steady_clock::now();
     auto on_progress = [ms, t0](uint64_t attempts, uint32_t lz, const std::string& hash_hex) {
       ms->attempts.store(attempts);
@@ -315,7 +363,7 @@ static void start_mining(App& app) {
       ms->last_hash_short = hash_hex.size() > 10 ? (hash_hex.substr(0, 10) + "...") : hash_hex;
     };
     try {
-      Block mined = mine_block(*chain_ptr, std::move(txs), difficulty, ms->cancel, on_progress, 50'000);
+      Block mined = mine_block(*view, std::move(txs), difficulty, ms->cancel, on_progress, 50'000);
       {
         std::lock_guard<std::mutex> lk(ms->mu);
         ms->mined_block = mined;
@@ -346,15 +394,11 @@ static bool do_clear_store(App& app) {
     if (app.mining.worker.joinable()) app.mining.worker.join();
     app.mining.mining.store(false);
   }
-  // Truncate the log file
+  // Let queued writes land, then truncate the log file and its index
   try {
-    std::ofstream trunc(app.store.log_path(), std::ios::binary | std::ios::trunc);
-    if (!trunc) {
-      app.push_log("clear store: open failed", 31);
-      app.toast("Clear store failed (open)", 31, 4.0);
-      return false;
-    }
-    trunc.close();
+    app.writer.flush();
+    poll_writes(app);
+    app.store.clear();
   } catch (...) {
     app.push_log("clear store: exception", 31);
     app.toast("Clear store exception", 31, 4.0);
@@ -363,6 +407,7 @@ static bool do_clear_store(App& app) {
   // Reset in-memory chain
   Chain new_chain(app.chain.config());
   app.chain = std::move(new_chain);
+  submit_snapshot(app);
   app.log_scroll = 0;
   app.push_log("store cleared; chain reset", 33);
   app.toast("Store cleared", 33, 4.0);
@@ -506,6 +551,7 @@ static void draw(App& app, int rows, int cols, tui::FPS& fps) {
   // Dim Mine if no tip
   put_action("M", "Mine PoW block", tip ? 37 : 90);
   put_action("I", "Inspect tip");
+  if (astro::core::trace::compiled_in) put_action("T", astro::core::trace::active() ? "Stop trace, save" : "Start trace");
   put_action("Q", "Quit");
   actions_row++;
   move(actions_row++, left_w+4); fg(2); write_str("OpenSSL "); reset(); write_str("EVP | secp256k1 | SHA-256");
@@ -639,6 +685,26 @@ static void draw(App& app, int rows, int cols, tui::FPS& fps) {
   fflush(stdout);
 }
 
+// Starts a trace, or saves the one running to ./data/trace.json for
+// ui.perfetto.dev.
+static void toggle_trace(App& app) {
+  if (!trace::compiled_in) return;
+  if (!trace::active()) {
+    trace::start();
+    app.push_log("tracing started", 36);
+    app.toast("Tracing", 36, 2.0);
+    return;
+  }
+  trace::stop();
+  if (trace::write_json_file("./data/trace.json")) {
+    app.push_log("trace saved to ./data/trace.json", 32);
+    app.toast("Trace saved", 32, 3.0);
+  } else {
+    app.push_log("[x] trace write failed", 31);
+    app.toast("Trace write failed", 31, 4.0);
+  }
+}
+
 static void on_sigint(int){ tui::g_running = false; }
 static std::atomic<bool> g_resized{false};
 static void on_sigwinch(int){ g_resized.store(true); }
@@ -652,13 +718,33 @@ int main() {
   }
   tui::ScreenGuard screen;
   tui::TermiosGuard tty;
+  ASTRO_TRACE_THREAD("tui");
+  trace::start_from_env();
 
   App app;
   tui::FPS fps;
-  app.chain.restore_from_store(app.store);
+  const auto& recovery = app.store.recovery();
+  if (recovery.discarded_bytes > 0) {
+    app.push_log("store recovery: discarded " + std::to_string(recovery.discarded_bytes) +
+                 " bytes of torn tail", 33);
+  }
+  auto snapshot = astro::storage::read_chain_snapshot("./data/chain.snap");
+  app.chain.restore_from_store(app.store, snapshot ? &*snapshot : nullptr);
   if (app.chain.height() > 0) {
     app.push_log("restored chain from ./data", 36);
   }
+  // Prometheus scrape endpoint; ASTRO_METRICS_PORT=0 turns it off.
+  std::unique_ptr<astro::net::MetricsServer> metrics_server;
+  astro::net::MetricsServerOptions metrics_options;
+  if (const char* port = std::getenv("ASTRO_METRICS_PORT")) metrics_options.port = static_cast<uint16_t>(std::atoi(port));
+  if (metrics_options.port != 0) {
+    try {
+      metrics_server = std::make_unique<astro::net::MetricsServer>(metrics_options, [&app] { return app.chain.view(); });
+      app.push_log("metrics on http://" + metrics_options.host + ":" + std::to_string(metrics_server->port()) + "/metrics", 36);
+    } catch (const std::exception& ex) {
+      app.push_log(std::string("metrics server not started: ") + ex.what(), 33);
+    }
+  }
   app.push_log("TUI started", 36);
   app.push_log("Press G to create genesis", 33);
   int rows = 36, cols = 120;
@@ -695,9 +781,10 @@ int main() {
       }
       app.mining.done.store(false);
       app.mining.mining.store(false);
+      ASTRO_TRACE_SPAN("tui.append_mined");
       // enforce difficulty for validation
       app.chain.set_difficulty_bits(app.ui_difficulty_bits);
-      auto vr = app.chain.append_and_store(mined, app.store);
+      auto vr = append_async(app, mined);
       if (vr.is_valid) {
         auto hh = mined.header.hash();
         app.push_log(std::string("[✅] mined block appended h=") + short_hash(hh), 32);
@@ -708,6 +795,8 @@ int main() {
       }
     }
 
+    poll_writes(app);
+
     for (int k; (k = tui::read_key()) != -1; ) {
       if (!debounce.allow(k)) continue;
       switch (k) {
@@ -721,12 +810,14 @@ int main() {
         case 'j': if (app.log_scroll + 1 < app.log.size()) { app.log_scroll++; app.dirty = true; } break;
         case 'k': if (app.log_scroll > 0) { app.log_scroll--; app.dirty = true; } break;
         case 'x': case 'X': do_clear_store(app); tui::drain_input(); break;
+        case 't': case 'T': toggle_trace(app); break;
         default: break;
       }
     }
 
     auto now = clock::now();
     if (app.dirty || (now - last_draw) >= min_draw_interval) {
+      ASTRO_TRACE_SPAN("tui.draw");
       draw(app, rows, cols, fps);
       fps.tick();
       app.dirty = false;
@@ -739,6 +830,7 @@ int main() {
 
   stop_mining(app);
   if (app.mining.worker.joinable()) app.mining.worker.join();
+  submit_snapshot(app);
   crypto_shutdown();
   return 0;
 }
\ No newline at end of file
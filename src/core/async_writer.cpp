@@ -0,0 +1,102 @@
+#include "astro/storage/async_writer.hpp"
+#include "astro/core/trace.hpp"
+#include <vector>
+
+using namespace astro::core;
+
+namespace astro::storage {
+
+  AsyncBlockWriter::AsyncBlockWriter(BlockStorage& store, size_t max_batch)
+    : store_(store), max_batch_(max_batch == 0 ? 1 : max_batch) {
+    thread_ = std::thread([this] { run(); });
+  }
+
+  AsyncBlockWriter::~AsyncBlockWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stopping_ = true;
+    }
+    work_cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  std::future<void> AsyncBlockWriter::enqueue(Block block) {
+    Pending pending{std::move(block), {}};
+    auto future = pending.durable.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (error_) {
+        pending.durable.set_exception(error_);
+        return future;
+      }
+      queue_.push_back(std::move(pending));
+    }
+    work_cv_.notify_one();
+    return future;
+  }
+
+  void AsyncBlockWriter::flush() {
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_cv_.wait(lock, [this] { return queue_.empty() && !in_flight_; });
+  }
+
+  bool AsyncBlockWriter::failed() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return error_ != nullptr;
+  }
+
+  uint64_t AsyncBlockWriter::commits() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return commits_;
+  }
+
+  void AsyncBlockWriter::run() {
+    ASTRO_TRACE_THREAD("store-writer");
+    std::vector<Pending> batch;
+    std::vector<Block> blocks;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        in_flight_ = false;
+        if (queue_.empty()) idle_cv_.notify_all();
+        work_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        // Drain before exiting so a clean shutdown loses nothing.
+        if (queue_.empty()) return;
+
+        batch.clear();
+        while (!queue_.empty() && batch.size() < max_batch_) {
+          batch.push_back(std::move(queue_.front()));
+          queue_.pop_front();
+        }
+        in_flight_ = true;
+      }
+
+      blocks.clear();
+      blocks.reserve(batch.size());
+      for (auto& pending : batch) blocks.push_back(std::move(pending.block));
+
+      std::exception_ptr error;
+      try {
+        store_.append_blocks(blocks);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      if (!error) {
+        for (auto& pending : batch) pending.durable.set_value();
+        std::lock_guard<std::mutex> lock(mu_);
+        ++commits_;
+        continue;
+      }
+
+      std::deque<Pending> abandoned;
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        error_ = error;
+        abandoned.swap(queue_);
+      }
+      for (auto& pending : batch) pending.durable.set_exception(error);
+      for (auto& pending : abandoned) pending.durable.set_exception(error);
+    }
+  }
+}
@@ -3,6 +3,7 @@
 #include "astro/core/hash.hpp"
 #include "astro/core/merkle.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 namespace astro::core {
@@ -40,6 +41,45 @@ namespace astro::core {
     return writer.take();
   }
 
+  static BlockHeader read_header(ByteReader& reader) {
+    BlockHeader header;
+    header.version = reader.read_u32();
+    for (size_t i = 0; i < header.prev_hash.size(); ++i) header.prev_hash[i] = reader.read_u8();
+    for (size_t i = 0; i < header.merkle_root.size(); ++i) header.merkle_root[i] = reader.read_u8();
+    header.timestamp = reader.read_u64();
+    header.nonce = reader.read_u64();
+    return header;
+  }
+
+  BlockHeader deserialize_header(std::span<const uint8_t> bytes) {
+    ByteReader reader(bytes);
+    return read_header(reader);
+  }
+
+  static std::vector<Transaction> read_body(ByteReader& reader) {
+    std::vector<Transaction> transactions;
+    auto num_txs = reader.read_u32();
+    transactions.reserve(std::min<size_t>(num_txs, reader.remaining_bytes() / 4));
+    for (uint32_t i = 0; i < num_txs; ++i) {
+      auto tx_bytes = reader.read_bytes();
+      transactions.push_back(deserialize_transaction(std::span<const uint8_t>(tx_bytes.data(), tx_bytes.size())));
+    }
+    return transactions;
+  }
+
+  Block deserialize_block(std::span<const uint8_t> bytes) {
+    ByteReader reader(bytes);
+    Block block;
+    block.header = read_header(reader);
+    block.transactions = read_body(reader);
+    return block;
+  }
+
+  std::vector<Transaction> deserialize_block_body(std::span<const uint8_t> bytes) {
+    ByteReader reader(bytes);
+    return read_body(reader);
+  }
+
   Hash256 empty_merkle_root() {
     const uint8_t* empty_hash = nullptr;
     return sha256(std::span<const uint8_t>(empty_hash, static_cast<size_t>(0)));
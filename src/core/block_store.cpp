@@ -1,11 +1,16 @@
 #include "astro/storage/block_store.hpp"
 #include "astro/core/serializer.hpp"
 #include "astro/core/hash.hpp"
+#include "astro/core/crc32c.hpp"
+#include "astro/core/metrics.hpp"
+#include "astro/core/trace.hpp"
 #include <filesystem>
 #include <fstream>
+#include <optional>
 #include <stdexcept>
 #include <system_error>
 #include <cstring>
+#include <algorithm>
 
 #ifndef _WIN32
   #include <unistd.h>
@@ -17,26 +22,35 @@ using namespace astro::core;
 
 namespace astro::storage {
   static constexpr uint32_t MAGIC = 0x41535452; // "ASTR"
-  static constexpr uint64_t VER = 1;
+  static constexpr uint64_t VER_SHA256 = 1; // payload followed by SHA-256(payload)
+  static constexpr uint64_t VER_CRC32C = 2; // payload followed by u32 CRC-32C(payload)
   static constexpr uint16_t KIND_BLOCK = 1;
+  static constexpr uint16_t KIND_HEADER = 2; // pruned block: serialized header only, no flags
+  // Flags in the high byte of `kind`, describing how the payload is encoded.
+  static constexpr uint16_t KIND_FLAG_LINKED = 0x0100;  // compact header, prev_hash elided
+  static constexpr uint16_t KIND_FLAG_KEY_IDS = 0x0200; // varint-coded txs, sender keys by dictionary id
+  static constexpr uint16_t KIND_FLAG_COMPRESSED = 0x0400; // u8 codec, varint raw size, codec output
+  static constexpr uint16_t KIND_FLAGS_KNOWN = KIND_FLAG_LINKED | KIND_FLAG_KEY_IDS | KIND_FLAG_COMPRESSED;
+  // Bytes of prev_hash kept in a linked header to check the rebuilt link.
+  static constexpr size_t LINK_FINGERPRINT_BYTES = 4;
 
-  static Transaction parse_transaction(std::span<const uint8_t> bytes) {
-    ByteReader reader(bytes);
-    (void)reader.read_u8(); // 0xA1
-    (void)reader.read_u8(); // 0x01
-    (void)reader.read_u32(); // reserved/schema
-    Transaction tx;
-    tx.version = reader.read_u32();
-    tx.nonce = reader.read_u64();
-    tx.amount = reader.read_u64();
-    tx.from_pub_pem = reader.read_bytes();
-    tx.to_label = reader.read_string();
-    tx.signature = reader.read_bytes();
-    return tx;
-  }
-  BlockStore::BlockStore(fs::path root_path) : root_path_(std::move(root_path)) {
+  // On-disk record framing: header fields are written back to back, no padding.
+  static constexpr uint64_t RECORD_HEADER_BYTES =
+    sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t) + sizeof(uint64_t);
+  static constexpr uint64_t MIN_CHECK_BYTES = sizeof(uint32_t);
+
+  static uint64_t check_bytes(uint64_t version) {
+    return version == VER_CRC32C ? sizeof(uint32_t) : sizeof(Hash256);
+  }
+
+  BlockStore::BlockStore(fs::path root_path, BlockStoreOptions options)
+    : root_path_(std::move(root_path)), options_(options), keys_(root_path_ / "keys.dict") {
     if (!fs::exists(root_path_)) fs::create_directories(root_path_);
     log_path_ = root_path_ / "chain.log";
+    index_path_ = root_path_ / "chain.idx";
+    if (options_.use_io_uring) ring_ = IoUring::create();
+    can_preallocate_ = options_.preallocate_bytes > 0;
+    recover();
     open_write_log();
   }
 
@@ -44,7 +58,9 @@ namespace astro::storage {
 
   void BlockStore::open_write_log() {
     #ifndef _WIN32
-      log_fd = ::open(log_path_.c_str(), O_CREAT | O_APPEND | O_WRONLY, 0644);
+      // Positioned writes at end_offset_, not O_APPEND: the file runs past the
+      // data when it is preallocated.
+      log_fd = ::open(log_path_.c_str(), O_CREAT | O_WRONLY, 0644);
       if (log_fd < 0) throw std::system_error(errno, std::generic_category(), "open write log");
     #else
       log_fd = 1;
@@ -57,100 +73,770 @@ namespace astro::storage {
     #endif
   }
 
-  void BlockStore::fsync_fd() {
+  void BlockStore::read_range(std::span<uint8_t> out, uint64_t offset) {
     #ifndef _WIN32
-      if (log_fd >= 0) ::fsync(log_fd);
+      int fd = ::open(log_path_.c_str(), O_RDONLY);
+      if (fd < 0) throw std::system_error(errno, std::generic_category(), "open read log");
+      try {
+        ring_->read_exact(fd, out, offset);
+      } catch (...) {
+        ::close(fd);
+        throw;
+      }
+      ::close(fd);
+    #else
+      (void)out; (void)offset;
+      throw std::runtime_error("BlockStore: io_uring reads unsupported");
     #endif
   }
 
-  void BlockStore::append_block(const Block& block) {
-    auto payload = block.serialize();
-    auto check = sha256(std::span<const uint8_t>(payload.data(), payload.size()));
+  void BlockStore::fsync_fd(bool data_only) {
+    #ifndef _WIN32
+      if (log_fd >= 0 && (data_only ? ::fdatasync(log_fd) : ::fsync(log_fd)) != 0) {
+        throw std::system_error(errno, std::generic_category(), "BlockStore: fsync failed");
+      }
+    #else
+      (void)data_only;
+    #endif
+  }
 
-    RecordHeader header{MAGIC, VER, KIND_BLOCK, static_cast<uint64_t>(payload.size())};
-    
-    std::ofstream out(log_path_, std::ios::binary | std::ios::app);
-    if (!out) throw std::runtime_error("BlockStore: open append failed");
+  // Makes sure [0, end) is allocated. Returns true when it already was, i.e. a
+  // write below `end` changes no file metadata and fdatasync is enough.
+  bool BlockStore::reserve(uint64_t end) {
+    if (end <= allocated_) return true;
+    if (!can_preallocate_) return false;
+    #ifdef __linux__
+      const uint64_t chunk = options_.preallocate_bytes;
+      const uint64_t target = (end + chunk - 1) / chunk * chunk;
+      if (::fallocate(log_fd, 0, static_cast<off_t>(allocated_), static_cast<off_t>(target - allocated_)) != 0) {
+        if (errno != EOPNOTSUPP && errno != ENOSYS) {
+          throw std::system_error(errno, std::generic_category(), "BlockStore: fallocate failed");
+        }
+        can_preallocate_ = false;
+        return false;
+      }
+      // Commit the new size once so the appends into it don't have to.
+      fsync_fd();
+      allocated_ = target;
+      return true;
+    #else
+      can_preallocate_ = false;
+      return false;
+    #endif
+  }
 
-    out.write(reinterpret_cast<const char*>(&header.magic), sizeof(header.magic));
-    out.write(reinterpret_cast<const char*>(&header.version), sizeof(header.version));
-    out.write(reinterpret_cast<const char*>(&header.kind), sizeof(header.kind));
-    out.write(reinterpret_cast<const char*>(&header.length), sizeof(header.length));
-    out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
-    out.write(reinterpret_cast<const char*>(check.data()), check.size());
+  void BlockStore::write_at(std::span<const uint8_t> data, uint64_t offset) {
+    #ifndef _WIN32
+      size_t done = 0;
+      while (done < data.size()) {
+        ssize_t n = ::pwrite(log_fd, data.data() + done, data.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+          if (errno == EINTR) continue;
+          throw std::system_error(errno, std::generic_category(), "BlockStore: write failed");
+        }
+        done += static_cast<size_t>(n);
+      }
+    #else
+      (void)offset; // no preallocation here, so the write offset is always the end
+      std::ofstream out(log_path_, std::ios::binary | std::ios::app);
+      out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+      out.flush();
+      if (!out.good()) throw std::runtime_error("BlockStore: write failed");
+    #endif
+  }
 
-    if (!out.good()) throw std::runtime_error("BlockStore: write failed");
-    out.flush();
-    fsync_fd();
+  template <class T> static void put_raw(std::vector<uint8_t>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
   }
 
-  static uint64_t read_u64(std::istream& in) {
-    uint64_t v; in.read(reinterpret_cast<char*>(&v), sizeof(v)); return v;
+  static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
   }
 
-  static uint32_t read_u32(std::istream& in) {
-    uint32_t v; in.read(reinterpret_cast<char*>(&v), sizeof(v)); return v;
+  static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
   }
 
-  static uint16_t read_u16(std::istream& in) {
-    uint16_t v; in.read(reinterpret_cast<char*>(&v), sizeof(v)); return v;
+  // Record payload for `block`. A block that extends the previous record (whose
+  // timestamp is `prev_timestamp`) gets a compact header: varint version,
+  // prev_hash fingerprint, merkle_root, zigzag timestamp delta, varint nonce.
+  // With `keys`, each tx is varint version, nonce, amount, sender key id, then
+  // varint-length to_label and signature. Returns the record kind.
+  static uint16_t encode_payload(const Block& block, std::optional<uint64_t> prev_timestamp,
+                                 KeyDictionary* keys, std::vector<uint8_t>& payload) {
+    payload = block.serialize();
+    if (!prev_timestamp && !keys) return KIND_BLOCK;
+
+    uint16_t kind = KIND_BLOCK;
+    const auto& header = block.header;
+    ByteWriter writer;
+    if (prev_timestamp) {
+      writer.write_varint(header.version);
+      writer.write_raw(std::span<const uint8_t>(header.prev_hash.data(), LINK_FINGERPRINT_BYTES));
+      writer.write_raw(std::span<const uint8_t>(header.merkle_root.data(), header.merkle_root.size()));
+      writer.write_varint(zigzag(static_cast<int64_t>(header.timestamp - *prev_timestamp)));
+      writer.write_varint(header.nonce);
+      kind |= KIND_FLAG_LINKED;
+    } else {
+      writer.write_raw(std::span<const uint8_t>(payload).first(BLOCK_HEADER_BYTES));
+    }
+
+    if (keys) {
+      writer.write_varint(block.transactions.size());
+      for (const auto& tx : block.transactions) {
+        writer.write_varint(tx.version);
+        writer.write_varint(tx.nonce);
+        writer.write_varint(tx.amount);
+        writer.write_varint(keys->intern(tx.from_pub_pem));
+        writer.write_varint(tx.to_label.size());
+        writer.write_raw(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(tx.to_label.data()),
+                                                  tx.to_label.size()));
+        writer.write_varint(tx.signature.size());
+        writer.write_raw(tx.signature);
+      }
+      kind |= KIND_FLAG_KEY_IDS;
+    } else {
+      writer.write_raw(std::span<const uint8_t>(payload).subspan(BLOCK_HEADER_BYTES));
+    }
+    payload = writer.take();
+    return kind;
   }
-  
-  std::vector<Block> BlockStore::load_all_blocks() {
-    std::vector<Block> out;
-    if (!fs::exists(log_path_)) return out;
 
-    std::ifstream in(log_path_, std::ios::binary);
-    if(!in) throw std::runtime_error("BlockStore: open read failed");
+  // Replaces `payload` with its compressed form if that pays off.
+  static bool compress_payload(Compression codec, std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> packed;
+    if (!compress(codec, payload, packed)) return false;
+    ByteWriter writer;
+    writer.write_u8(static_cast<uint8_t>(codec));
+    writer.write_varint(payload.size());
+    writer.write_raw(packed);
+    if (writer.buffer().size() > payload.size() - payload.size() / 8) return false;
+    payload = writer.take();
+    return true;
+  }
+
+  // Appends one framed record (header, payload, checksum) to `out`; returns its size.
+  static uint64_t encode_record(std::span<const uint8_t> payload, uint16_t kind, RecordChecksum checksum,
+                                std::vector<uint8_t>& out) {
+    const bool use_crc = checksum == RecordChecksum::Crc32c;
+
+    RecordHeader header{MAGIC, use_crc ? VER_CRC32C : VER_SHA256, kind,
+                        static_cast<uint64_t>(payload.size())};
+    put_raw(out, header.magic);
+    put_raw(out, header.version);
+    put_raw(out, header.kind);
+    put_raw(out, header.length);
+    out.insert(out.end(), payload.begin(), payload.end());
+    if (use_crc) {
+      put_raw(out, crc32c(payload));
+    } else {
+      auto check = sha256(payload);
+      out.insert(out.end(), check.begin(), check.end());
+    }
+    return RECORD_HEADER_BYTES + payload.size() + check_bytes(header.version);
+  }
 
-    while (in.peek() != std::char_traits<char>::eof()) {
-      uint32_t magic = read_u32(in);
-      if (!in) break;
-      uint64_t version = read_u64(in);
-      uint16_t kind = read_u16(in);
-      uint64_t length = read_u64(in);
-      if (!in) break;
+  void BlockStore::append_block(const Block& block) {
+    append_blocks(std::span<const Block>(&block, 1));
+  }
+
+  void BlockStore::append_blocks(std::span<const Block> blocks) {
+    if (blocks.empty()) return;
+    ASTRO_TRACE_SPAN("store.append");
 
-      if (magic != MAGIC || version != VER || kind != KIND_BLOCK) {
-        break;
+    std::vector<uint8_t> buffer;
+    std::vector<uint64_t> record_offsets;
+    record_offsets.reserve(blocks.size());
+    uint64_t offset = end_offset_;
+    std::optional<Link> link = link_;
+    std::vector<uint8_t> payload;
+    {
+      ASTRO_METRICS_TIMER(metrics::Timer::StoreSerialize);
+      ASTRO_TRACE_SPAN("store.serialize");
+      for (const auto& block : blocks) {
+        record_offsets.push_back(offset);
+        const bool linked = options_.compact_headers && link && block.header.prev_hash == link->hash;
+        uint16_t kind = encode_payload(block, linked ? std::optional(link->timestamp) : std::nullopt,
+                                       options_.key_dictionary ? &keys_ : nullptr, payload);
+        if (options_.compression != Compression::None && payload.size() >= options_.compress_min_bytes &&
+            compress_payload(options_.compression, payload)) {
+          kind |= KIND_FLAG_COMPRESSED;
+        }
+        offset += encode_record(payload, kind, options_.checksum, buffer);
+        if (options_.compact_headers) link = Link{block.header.hash(), block.header.timestamp};
       }
+    }
 
-      std::vector<uint8_t> payload;
-      payload.resize(length);
-      in.read(reinterpret_cast<char*>(payload.data()), payload.size());
-      if (!in) break;
+    // On failure drop whatever part of the batch made it out so the next
+    // append doesn't land behind garbage. The preallocated tail goes with it:
+    // a shorter retry must not leave stale records from this batch behind it.
+    auto rollback = [&] {
+      std::error_code ec;
+      fs::resize_file(log_path_, end_offset_, ec);
+      if (!ec) allocated_ = end_offset_;
+    };
 
-      Hash256 check{};
-      in.read(reinterpret_cast<char*>(check.data()), check.size());
-      if (!in) break;
+    // Keys first: a record must never reach the log before the ids it uses.
+    keys_.commit();
 
-      auto calculated_check = sha256(std::span<const uint8_t>(payload.data(), payload.size()));
-      if (calculated_check != check) {
-        break;
+    const std::span<const uint8_t> data(buffer.data(), buffer.size());
+    try {
+      const bool in_place = reserve(offset);
+      if (ring_) {
+        ASTRO_METRICS_TIMER(metrics::Timer::StoreWrite);
+        ASTRO_TRACE_SPAN("store.write");
+        ring_->write_and_fsync(log_fd, data, end_offset_, in_place);
+      } else {
+        {
+          ASTRO_METRICS_TIMER(metrics::Timer::StoreWrite);
+          ASTRO_TRACE_SPAN("store.write");
+          write_at(data, end_offset_);
+        }
+        ASTRO_METRICS_TIMER(metrics::Timer::StoreFsync);
+        ASTRO_TRACE_SPAN("store.fsync");
+        fsync_fd(in_place);
       }
+    } catch (...) {
+      rollback();
+      throw;
+    }
+
+    allocated_ = std::max(allocated_, offset);
+    link_ = link;
+    offsets_.insert(offsets_.end(), record_offsets.begin(), record_offsets.end());
+    append_index(record_offsets);
+    end_offset_ = offset;
+    ASTRO_METRICS_ADD(metrics::Counter::StoreBlocksAppended, blocks.size());
+    ASTRO_METRICS_ADD(metrics::Counter::StoreBytesAppended, buffer.size());
+  }
+
+  struct RecordView {
+    uint64_t version = 0;
+    uint16_t kind = 0;
+    std::span<const uint8_t> payload;
+  };
+
+  template <class T> static T get_raw(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+  }
+
+  // Parses and verifies the record at the start of `bytes`. Returns its size on
+  // disk, or 0 when it is torn (runs past the end of `bytes`) or corrupt.
+  static uint64_t decode_record(std::span<const uint8_t> bytes, RecordView& view) {
+    if (bytes.size() < RECORD_HEADER_BYTES + MIN_CHECK_BYTES) return 0;
+    const uint8_t* p = bytes.data();
+    uint32_t magic = get_raw<uint32_t>(p);
+    uint64_t version = get_raw<uint64_t>(p + 4);
+    uint16_t kind = get_raw<uint16_t>(p + 12);
+    uint64_t length = get_raw<uint64_t>(p + 14);
+
+    if (magic != MAGIC) return 0;
+    if (kind != KIND_HEADER && ((kind & 0xFF) != KIND_BLOCK || (kind & 0xFF00 & ~KIND_FLAGS_KNOWN))) return 0;
+    if (version != VER_SHA256 && version != VER_CRC32C) return 0;
+    const uint64_t check_size = check_bytes(version);
+    const uint64_t available = bytes.size() - RECORD_HEADER_BYTES;
+    if (check_size > available || length > available - check_size) return 0;
 
-      // Reconstructing via serializer primitives to match Block::serialize
-      ByteReader reader(payload);
-      BlockHeader header;
-      header.version = reader.read_u32();
-      for (size_t i = 0; i < header.prev_hash.size(); ++i) header.prev_hash[i] = reader.read_u8();
+    auto payload = bytes.subspan(RECORD_HEADER_BYTES, length);
+    auto check = bytes.subspan(RECORD_HEADER_BYTES + length, check_size);
+    if (version == VER_CRC32C) {
+      if (crc32c(payload) != get_raw<uint32_t>(check.data())) return 0;
+    } else {
+      auto calculated_check = sha256(payload);
+      if (!std::equal(calculated_check.begin(), calculated_check.end(), check.begin())) return 0;
+    }
+    view = {version, kind, payload};
+    return RECORD_HEADER_BYTES + length + check_size;
+  }
+
+  // Decompresses a verified record's payload into `scratch` and points the view
+  // at it. Needs nothing from other records, so it can run on any thread.
+  static void unpack_record(RecordView& record, std::vector<uint8_t>& scratch) {
+    if (!(record.kind & KIND_FLAG_COMPRESSED)) return;
+    ByteReader reader(record.payload);
+    const auto codec = static_cast<Compression>(reader.read_u8());
+    const uint64_t raw_size = reader.read_varint();
+    decompress(codec, record.payload.subspan(reader.position()), raw_size, scratch);
+    record.payload = scratch;
+    record.kind &= static_cast<uint16_t>(~KIND_FLAG_COMPRESSED);
+  }
+
+  // Rebuilds the block in a verified, unpacked record. A linked record gets prev_hash from
+  // `prev`, the block before it, and must match the fingerprint it kept.
+  static std::vector<Transaction> decode_transactions(const RecordView& record, ByteReader& reader,
+                                                      const KeyDictionary& keys) {
+    if (!(record.kind & KIND_FLAG_KEY_IDS)) return deserialize_block_body(record.payload.subspan(reader.position()));
+    const uint64_t num_txs = reader.read_varint();
+    std::vector<Transaction> transactions;
+    transactions.reserve(std::min<uint64_t>(num_txs, reader.remaining_bytes()));
+    for (uint64_t i = 0; i < num_txs; ++i) {
+      Transaction tx;
+      tx.version = static_cast<uint16_t>(reader.read_varint());
+      tx.nonce = reader.read_varint();
+      tx.amount = reader.read_varint();
+      tx.from_pub_pem = keys.at(reader.read_varint());
+      auto label = reader.read_raw(reader.read_varint());
+      tx.to_label.assign(reinterpret_cast<const char*>(label.data()), label.size());
+      auto signature = reader.read_raw(reader.read_varint());
+      tx.signature.assign(signature.begin(), signature.end());
+      transactions.push_back(std::move(tx));
+    }
+    return transactions;
+  }
+
+  // The transactions alone; linked headers are skipped rather than rebuilt,
+  // so no predecessor is needed.
+  static std::vector<Transaction> decode_body(const RecordView& record, const KeyDictionary& keys) {
+    if (record.kind == KIND_HEADER) return {};
+    ByteReader reader(record.payload);
+    if (record.kind & KIND_FLAG_LINKED) {
+      reader.read_varint();
+      reader.read_raw(LINK_FINGERPRINT_BYTES + sizeof(Hash256));
+      reader.read_varint();
+      reader.read_varint();
+    } else {
+      reader.read_raw(BLOCK_HEADER_BYTES);
+    }
+    return decode_transactions(record, reader, keys);
+  }
+
+  static Block decode_block(const RecordView& record, const Block* prev, const KeyDictionary& keys) {
+    if (record.kind == KIND_HEADER) return Block{deserialize_header(record.payload), {}};
+    if (!(record.kind & KIND_FLAGS_KNOWN)) return deserialize_block(record.payload);
+
+    ByteReader reader(record.payload);
+    Block block;
+    auto& header = block.header;
+    if (record.kind & KIND_FLAG_LINKED) {
+      if (!prev) throw std::runtime_error("BlockStore: linked record without a predecessor");
+      header.version = static_cast<uint32_t>(reader.read_varint());
+      header.prev_hash = prev->header.hash();
+      for (size_t i = 0; i < LINK_FINGERPRINT_BYTES; ++i) {
+        if (reader.read_u8() != header.prev_hash[i]) {
+          throw std::runtime_error("BlockStore: linked record does not extend its predecessor");
+        }
+      }
       for (size_t i = 0; i < header.merkle_root.size(); ++i) header.merkle_root[i] = reader.read_u8();
-      header.timestamp = reader.read_u64();
-      header.nonce = reader.read_u64();
+      header.timestamp = prev->header.timestamp + static_cast<uint64_t>(unzigzag(reader.read_varint()));
+      header.nonce = reader.read_varint();
+    } else {
+      header = deserialize_header(reader.read_raw(BLOCK_HEADER_BYTES));
+    }
 
-      Block block;
-      block.header = header;
+    block.transactions = decode_transactions(record, reader, keys);
+    return block;
+  }
 
-      auto num_txs = reader.read_u32();
-      block.transactions.reserve(num_txs);
-      for (uint32_t i=0; i<num_txs; ++i) {
-        auto tx_bytes = reader.read_bytes();
-        Transaction tx = parse_transaction(std::span<const uint8_t>(tx_bytes.data(), tx_bytes.size()));
-        block.transactions.push_back(std::move(tx));
+  // Streams the record at `offset` into `buffer` and decodes it there.
+  static uint64_t read_record(std::istream& in, uint64_t offset, uint64_t limit,
+                              std::vector<uint8_t>& buffer, RecordView& view) {
+    if (offset > limit || limit - offset < RECORD_HEADER_BYTES + MIN_CHECK_BYTES) return 0;
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+
+    buffer.resize(RECORD_HEADER_BYTES);
+    in.read(reinterpret_cast<char*>(buffer.data()), RECORD_HEADER_BYTES);
+    if (!in) return 0;
+    const uint64_t version = get_raw<uint64_t>(buffer.data() + 4);
+    const uint64_t length = get_raw<uint64_t>(buffer.data() + 14);
+    const uint64_t check_size = check_bytes(version);
+    const uint64_t available = limit - offset - RECORD_HEADER_BYTES;
+    if (check_size > available || length > available - check_size) return 0;
+
+    buffer.resize(RECORD_HEADER_BYTES + length + check_size);
+    in.read(reinterpret_cast<char*>(buffer.data() + RECORD_HEADER_BYTES),
+            static_cast<std::streamsize>(length + check_size));
+    if (!in) return 0;
+    return decode_record(std::span<const uint8_t>(buffer.data(), buffer.size()), view);
+  }
+
+  // Serves records below `end` a window at a time for scans through io_uring,
+  // so at most one window, or one record if that is bigger, is held. A
+  // record running past the window is read again from its start. depth()
+  // MiB keeps every slot of the ring busy; read_range reads 1 MiB per slot.
+  template <class Read>
+  class RecordWindow {
+    public:
+      RecordWindow(Read read, uint64_t window, uint64_t end) : read_(std::move(read)), window_(window), end_(end) {}
+
+      // Like decode_record on the bytes from `offset` on.
+      uint64_t decode(uint64_t offset, RecordView& view) {
+        if (offset >= end_) return 0;
+        if (!covers(offset, std::min(RECORD_HEADER_BYTES, end_ - offset))) fill(offset, RECORD_HEADER_BYTES);
+        if (end_ - offset >= RECORD_HEADER_BYTES) {
+          const uint8_t* p = bytes_.data() + (offset - base_);
+          const uint64_t length = get_raw<uint64_t>(p + 14);
+          const uint64_t rest = end_ - offset - RECORD_HEADER_BYTES;
+          const uint64_t check_size = check_bytes(get_raw<uint64_t>(p + 4));
+          if (check_size <= rest && length <= rest - check_size) {
+            const uint64_t size = RECORD_HEADER_BYTES + length + check_size;
+            if (!covers(offset, size)) fill(offset, size);
+          }
+        }
+        return decode_record(std::span<const uint8_t>(bytes_).subspan(offset - base_), view);
       }
 
-      out.push_back(std::move(block));
+    private:
+      bool covers(uint64_t offset, uint64_t size) const {
+        return offset >= base_ && offset - base_ <= bytes_.size() && size <= bytes_.size() - (offset - base_);
+      }
+      void fill(uint64_t offset, uint64_t at_least) {
+        bytes_.resize(std::min(end_ - offset, std::max(window_, at_least)));
+        read_(std::span<uint8_t>(bytes_.data(), bytes_.size()), offset);
+        base_ = offset;
+      }
+
+      Read read_;
+      const uint64_t window_;
+      const uint64_t end_;
+      uint64_t base_ = 0;
+      std::vector<uint8_t> bytes_;
+  };
+
+  // Whether a record that checks out starts anywhere in (from, end). A torn
+  // append leaves only zeros and fragments behind the last good record, so
+  // one that reads back whole means the log was damaged in the middle.
+  static bool record_follows(std::istream& in, uint64_t from, uint64_t end) {
+    uint8_t magic[sizeof(MAGIC)];
+    std::memcpy(magic, &MAGIC, sizeof(MAGIC));
+    std::vector<uint8_t> chunk(64 * 1024), buffer;
+    RecordView record;
+    for (uint64_t at = from + 1; at + sizeof(MAGIC) <= end;) {
+      in.clear();
+      in.seekg(static_cast<std::streamoff>(at));
+      in.read(reinterpret_cast<char*>(chunk.data()),
+              static_cast<std::streamsize>(std::min<uint64_t>(chunk.size(), end - at)));
+      const auto got = static_cast<size_t>(in.gcount());
+      if (got < sizeof(MAGIC)) break;
+      for (auto it = chunk.begin(), stop = chunk.begin() + static_cast<std::ptrdiff_t>(got);
+           (it = std::search(it, stop, magic, magic + sizeof(magic))) != stop; ++it) {
+        const uint64_t candidate = at + static_cast<uint64_t>(it - chunk.begin());
+        if (read_record(in, candidate, end, buffer, record)) return true;
+      }
+      // Step back so a magic split across two reads is still seen.
+      at += got - (sizeof(MAGIC) - 1);
+    }
+    return false;
+  }
+
+  void BlockStore::recover() {
+    recovery_ = {};
+    offsets_.clear();
+    end_offset_ = 0;
+    allocated_ = 0;
+    if (!fs::exists(log_path_)) {
+      if (fs::exists(index_path_)) fs::remove(index_path_);
+      return;
+    }
+    const uint64_t file_size = fs::file_size(log_path_);
+
+    // The index is a checkpoint of record start offsets (one u64 each). It is
+    // written after the record is durable, so it may lag the log but should
+    // never point past it; anything that does is stale and dropped.
+    std::vector<uint64_t> indexed;
+    size_t index_entries = 0;
+    if (fs::exists(index_path_)) {
+      std::ifstream idx(index_path_, std::ios::binary);
+      uint64_t offset = 0;
+      bool monotonic = true;
+      while (idx.read(reinterpret_cast<char*>(&offset), sizeof(offset))) {
+        ++index_entries;
+        if (!monotonic || offset >= file_size || (!indexed.empty() && offset <= indexed.back())) {
+          monotonic = false;
+          continue;
+        }
+        indexed.push_back(offset);
+      }
     }
+
+    std::ifstream in(log_path_, std::ios::binary);
+    if (!in) throw std::runtime_error("BlockStore: open read failed");
+    std::vector<uint8_t> buffer;
+    RecordView record;
+
+    // Trust the checkpoint up to its last record, re-verify that one, and
+    // scan forward from there. Only fall back to a full scan if it's bad.
+    uint64_t pos = 0;
+    bool index_ok = false;
+    if (!indexed.empty() && indexed.front() == 0) {
+      uint64_t last = indexed.back();
+      if (uint64_t size = read_record(in, last, file_size, buffer, record)) {
+        offsets_ = std::move(indexed);
+        pos = last + size;
+        recovery_.scanned_records = 1;
+        index_ok = true;
+      }
+    }
+    recovery_.index_rebuilt = !index_ok && file_size > 0;
+
+    // With io_uring the rest of the file (everything on a rebuild) is read
+    // with deep-queue reads a window at a time and decoded from memory.
+    const size_t checkpointed = offsets_.size();
+    auto read = [this](std::span<uint8_t> out, uint64_t offset) { read_range(out, offset); };
+    std::optional<RecordWindow<decltype(read)>> window;
+    if (ring_) window.emplace(read, uint64_t{ring_->depth()} << 20, file_size);
+    auto next_record = [&](uint64_t at) -> uint64_t {
+      if (!window) return read_record(in, at, file_size, buffer, record);
+      return window->decode(at, record);
+    };
+    while (pos < file_size) {
+      uint64_t size = next_record(pos);
+      if (size == 0) break;
+      offsets_.push_back(pos);
+      pos += size;
+      ++recovery_.scanned_records;
+    }
+
+    // Past the last record there should only be preallocated zeros. Anything
+    // non-zero is a torn append; it is cut off, preallocation included.
+    uint64_t dirty_end = pos;
+    if (pos < file_size) {
+      in.clear();
+      in.seekg(static_cast<std::streamoff>(pos));
+      buffer.resize(64 * 1024);
+      for (uint64_t at = pos; at < file_size;) {
+        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        const auto got = static_cast<size_t>(in.gcount());
+        if (got == 0) break;
+        auto last = std::find_if(buffer.rend() - static_cast<std::ptrdiff_t>(got), buffer.rend(),
+                                 [](uint8_t b) { return b != 0; });
+        if (last != buffer.rend()) dirty_end = at + static_cast<uint64_t>(buffer.rend() - last);
+        at += got;
+      }
+    }
+
+    // Pruning leaves header-only records as a prefix of the log.
+    auto kind_at = [&](uint64_t offset) {
+      uint16_t kind = 0;
+      in.clear();
+      in.seekg(static_cast<std::streamoff>(offset + sizeof(uint32_t) + sizeof(uint64_t)));
+      in.read(reinterpret_cast<char*>(&kind), sizeof(kind));
+      return kind;
+    };
+    size_t lo = 0, hi = offsets_.size();
+    while (lo < hi) {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (kind_at(offsets_[mid]) == KIND_HEADER) lo = mid + 1;
+      else hi = mid;
+    }
+    header_only_ = lo;
+
+    if (dirty_end > pos && record_follows(in, pos, dirty_end)) {
+      throw std::runtime_error("BlockStore: corrupt record");
+    }
+    in.close();
+
+    if (dirty_end > pos) {
+      fs::resize_file(log_path_, pos);
+      recovery_.discarded_bytes = dirty_end - pos;
+      allocated_ = pos;
+    } else {
+      allocated_ = file_size;
+      recovery_.preallocated_bytes = file_size - pos;
+    }
+    end_offset_ = pos;
+    recovery_.records = offsets_.size();
+    recovery_.valid_bytes = pos;
+
+    if (!index_ok || index_entries != checkpointed) {
+      rewrite_index();
+    } else {
+      append_index(std::span<const uint64_t>(offsets_).subspan(checkpointed));
+    }
+  }
+
+  void BlockStore::prune_bodies(uint64_t height) {
+    height = std::min<uint64_t>(height, offsets_.size());
+    if (height <= header_only_) return;
+    auto end_of = [&](uint64_t i) { return i < offsets_.size() ? offsets_[i] : end_offset_; };
+    const uint64_t current = end_of(height) - end_of(header_only_);
+    const uint64_t pruned = (height - header_only_) *
+      (RECORD_HEADER_BYTES + BLOCK_HEADER_BYTES + check_bytes(options_.checksum == RecordChecksum::Crc32c ? VER_CRC32C : VER_SHA256));
+    if (current < pruned + options_.prune_compact_bytes) return;
+    compact(height);
+  }
+
+  static void fsync_path(const fs::path& path, bool directory = false) {
+    #ifndef _WIN32
+      int fd = ::open(path.c_str(), directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+      if (fd < 0) throw std::system_error(errno, std::generic_category(), "BlockStore: open for fsync failed");
+      int rc = ::fsync(fd);
+      int err = errno;
+      ::close(fd);
+      if (rc != 0) throw std::system_error(err, std::generic_category(), "BlockStore: fsync failed");
+    #else
+      (void)path; (void)directory;
+    #endif
+  }
+
+  void BlockStore::compact(uint64_t height) {
+    auto tmp_path = log_path_;
+    tmp_path += ".compact";
+    const uint64_t tail_start = height < offsets_.size() ? offsets_[height] : end_offset_;
+
+    std::vector<uint8_t> headers;
+    std::vector<uint64_t> offsets;
+    offsets.reserve(offsets_.size());
+    try {
+      std::ifstream in(log_path_, std::ios::binary);
+      if (!in) throw std::runtime_error("BlockStore: open read failed");
+      std::vector<uint8_t> buffer, scratch;
+      RecordView record;
+      Block prev;
+      for (uint64_t i = 0; i < height; ++i) {
+        if (read_record(in, offsets_[i], end_offset_, buffer, record) == 0) {
+          throw std::runtime_error("BlockStore: unreadable record during compaction");
+        }
+        unpack_record(record, scratch);
+        prev = Block{decode_block(record, i ? &prev : nullptr, keys_).header, {}};
+        offsets.push_back(headers.size());
+        auto header_bytes = prev.header.serialize();
+        encode_record(header_bytes, KIND_HEADER, options_.checksum, headers);
+      }
+      for (uint64_t i = height; i < offsets_.size(); ++i) offsets.push_back(headers.size() + offsets_[i] - tail_start);
+
+      std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+      if (!out) throw std::runtime_error("BlockStore: open compaction output failed");
+      out.write(reinterpret_cast<const char*>(headers.data()), static_cast<std::streamsize>(headers.size()));
+      in.clear();
+      in.seekg(static_cast<std::streamoff>(tail_start));
+      buffer.resize(1 << 20);
+      for (uint64_t left = end_offset_ - tail_start; left > 0;) {
+        const auto n = static_cast<std::streamsize>(std::min<uint64_t>(left, buffer.size()));
+        if (!in.read(reinterpret_cast<char*>(buffer.data()), n)) throw std::runtime_error("BlockStore: compaction read failed");
+        out.write(reinterpret_cast<const char*>(buffer.data()), n);
+        left -= static_cast<uint64_t>(n);
+      }
+      out.close();
+      if (!out.good()) throw std::runtime_error("BlockStore: compaction write failed");
+      fsync_path(tmp_path);
+    } catch (...) {
+      std::error_code ec;
+      fs::remove(tmp_path, ec);
+      throw;
+    }
+
+    // Drop the index before swapping logs: a crash in between then costs a
+    // full rescan instead of leaving offsets that point into the old file.
+    std::error_code ec;
+    fs::remove(index_path_, ec);
+    close_write_log();
+    body_in_.close();
+    fs::rename(tmp_path, log_path_);
+    fsync_path(root_path_, true);
+
+    end_offset_ = headers.size() + (end_offset_ - tail_start);
+    allocated_ = end_offset_;
+    offsets_ = std::move(offsets);
+    header_only_ = height;
+    open_write_log();
+    rewrite_index();
+  }
+
+  void BlockStore::rewrite_index() {
+    auto tmp_path = index_path_;
+    tmp_path += ".tmp";
+    {
+      std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+      if (!out) throw std::runtime_error("BlockStore: open index failed");
+      out.write(reinterpret_cast<const char*>(offsets_.data()),
+                static_cast<std::streamsize>(offsets_.size() * sizeof(uint64_t)));
+      if (!out.good()) throw std::runtime_error("BlockStore: index write failed");
+    }
+    fs::rename(tmp_path, index_path_);
+  }
+
+  void BlockStore::append_index(std::span<const uint64_t> offsets) {
+    if (offsets.empty()) return;
+    // Not fsynced: a lagging index only means a slightly longer tail scan.
+    std::ofstream out(index_path_, std::ios::binary | std::ios::app);
+    if (!out) return;
+    out.write(reinterpret_cast<const char*>(offsets.data()),
+              static_cast<std::streamsize>(offsets.size_bytes()));
+  }
+
+  void BlockStore::clear() {
+    fs::resize_file(log_path_, 0);
+    allocated_ = 0;
+    link_.reset();
+    keys_.clear();
+    header_only_ = 0;
+    std::error_code ec;
+    fs::remove(index_path_, ec);
+    offsets_.clear();
+    end_offset_ = 0;
+    recovery_ = {};
+  }
+  
+  std::vector<Block> BlockStore::load_all_blocks() {
+    std::vector<Block> out;
+    out.reserve(offsets_.size());
+    load_blocks([&](Block&& block) {
+      out.push_back(std::move(block));
+      return true;
+    });
     return out;
   }
-}
\ No newline at end of file
+
+  void BlockStore::load_blocks(const std::function<bool(Block&&)>& sink) {
+    if (offsets_.empty()) return;
+    ASTRO_METRICS_TIMER(metrics::Timer::StoreLoad);
+    ASTRO_TRACE_SPAN("store.load");
+
+    // Linked records only need the previous header, not its body.
+    Block prev;
+    bool have_prev = false;
+    RecordView record;
+    std::vector<uint8_t> scratch;
+    auto emit = [&]() {
+      unpack_record(record, scratch);
+      Block block = decode_block(record, have_prev ? &prev : nullptr, keys_);
+      prev.header = block.header;
+      have_prev = true;
+      ASTRO_METRICS_ADD(metrics::Counter::StoreBlocksLoaded, 1);
+      return sink(std::move(block));
+    };
+
+    if (ring_) {
+      RecordWindow window([this](std::span<uint8_t> out, uint64_t offset) { read_range(out, offset); },
+                          uint64_t{ring_->depth()} << 20, end_offset_);
+      for (uint64_t offset : offsets_) {
+        if (window.decode(offset, record) == 0) throw std::runtime_error("BlockStore: corrupt record");
+        if (!emit()) return;
+      }
+      return;
+    }
+
+    std::ifstream in(log_path_, std::ios::binary);
+    if(!in) throw std::runtime_error("BlockStore: open read failed");
+    std::vector<uint8_t> buffer;
+    for (uint64_t offset : offsets_) {
+      if (read_record(in, offset, end_offset_, buffer, record) == 0) throw std::runtime_error("BlockStore: corrupt record");
+      if (!emit()) return;
+    }
+  }
+
+  std::vector<Transaction> BlockStore::read_body(uint64_t height) {
+    if (height >= offsets_.size()) throw std::out_of_range("BlockStore: no block at that height");
+    const uint64_t offset = offsets_[height];
+    const uint64_t next = height + 1 < offsets_.size() ? offsets_[height + 1] : end_offset_;
+    std::vector<uint8_t> buffer(next - offset);
+    if (ring_) {
+      read_range(std::span<uint8_t>(buffer.data(), buffer.size()), offset);
+    } else {
+      if (!body_in_.is_open()) body_in_.open(log_path_, std::ios::binary);
+      body_in_.clear();
+      body_in_.seekg(static_cast<std::streamoff>(offset));
+      body_in_.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+      if (!body_in_) throw std::runtime_error("BlockStore: read failed");
+    }
+    RecordView record;
+    if (decode_record(buffer, record) == 0) throw std::runtime_error("BlockStore: corrupt record");
+    std::vector<uint8_t> scratch;
+    unpack_record(record, scratch);
+    return decode_body(record, keys_);
+  }
+}
@@ -0,0 +1,235 @@
+#include "astro/core/block_stream.hpp"
+#include <algorithm>
+#include <exception>
+#include "astro/core/keys.hpp"
+#include "astro/core/serializer.hpp"
+#include "astro/core/trace.hpp"
+
+namespace astro::core {
+  // Length prefix aside, a transaction with empty key, label and signature:
+  // tag/schema, version, nonce, amount, three field lengths.
+  static constexpr size_t MIN_TRANSACTION_BYTES = 6 + 4 + 8 + 8 + 3 * 4;
+
+  // A key that doesn't parse makes verify_message throw; here, on a worker
+  // thread, that counts as a bad signature.
+  static bool verified(const std::vector<uint8_t>& pubkey, std::span<const uint8_t> message,
+                       std::span<const uint8_t> signature) {
+    try {
+      return verify_message(pubkey, message, signature);
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  BlockStreamValidator::BlockStreamValidator(const Chain& chain, BlockStreamLimits limits, size_t verify_threads)
+    : chain_(chain), limits_(limits), is_genesis_candidate_(chain.height() == 0) {
+    if (const Ledger* ledger = chain.ledger()) nonces_.emplace(*ledger);
+    for (size_t i = 0; i < verify_threads; ++i) verifiers_.emplace_back([this] { run_verifier(); });
+  }
+
+  BlockStreamValidator::~BlockStreamValidator() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+      queue_.clear();
+    }
+    work_cv_.notify_all();
+    for (auto& verifier : verifiers_) verifier.join();
+  }
+
+  bool BlockStreamValidator::feed(std::span<const uint8_t> bytes) {
+    ASTRO_TRACE_SPAN("validate.stream");
+    if (verdict_) return false;
+    bytes_fed_ += bytes.size();
+    if (bytes_fed_ > limits_.max_block_bytes) return reject(ValidationError::OversizedBlock);
+    while (!bytes.empty()) {
+      if (part_ == Part::Done) return reject(ValidationError::MalformedBlock);
+      // Whole parts are read straight from `bytes`; only one split across
+      // calls is copied.
+      std::span<const uint8_t> part;
+      if (pending_.empty() && bytes.size() >= need_) {
+        part = bytes.first(need_);
+        bytes = bytes.subspan(need_);
+      } else {
+        const size_t take = std::min(need_ - pending_.size(), bytes.size());
+        pending_.insert(pending_.end(), bytes.begin(), bytes.begin() + take);
+        bytes = bytes.subspan(take);
+        if (pending_.size() < need_) break;
+        part = pending_;
+      }
+      const bool ok = consume(part);
+      pending_.clear();
+      if (!ok) return false;
+    }
+    return true;
+  }
+
+  bool BlockStreamValidator::consume(std::span<const uint8_t> part) {
+    switch (part_) {
+      case Part::Header: {
+        const BlockHeader header = deserialize_header(part);
+        const auto result = chain_.validate_header(header);
+        if (!result.is_valid) return reject(result.error, result.transaction_index);
+        header_ = header;
+        part_ = Part::Count;
+        need_ = sizeof(uint32_t);
+        return true;
+      }
+      case Part::Count: {
+        ByteReader reader(part);
+        transactions_ = reader.read_u32();
+        // Turned away before any of them arrives if they can't all fit.
+        const uint64_t smallest = BLOCK_HEADER_BYTES + sizeof(uint32_t) +
+                                  uint64_t{transactions_} * (sizeof(uint32_t) + MIN_TRANSACTION_BYTES);
+        if (smallest > limits_.max_block_bytes) return reject(ValidationError::OversizedBlock);
+        part_ = transactions_ == 0 ? Part::Done : Part::Length;
+        need_ = transactions_ == 0 ? 0 : sizeof(uint32_t);
+        return true;
+      }
+      case Part::Length: {
+        ByteReader reader(part);
+        const uint32_t length = reader.read_u32();
+        if (length > limits_.max_transaction_bytes) return reject(ValidationError::OversizedBlock, next_index_);
+        if (length < MIN_TRANSACTION_BYTES) return reject(ValidationError::MalformedBlock, next_index_);
+        part_ = Part::Transaction;
+        need_ = length;
+        return true;
+      }
+      case Part::Transaction: {
+        if (!consume_transaction(part)) return false;
+        ++next_index_;
+        part_ = next_index_ == transactions_ ? Part::Done : Part::Length;
+        need_ = next_index_ == transactions_ ? 0 : sizeof(uint32_t);
+        return true;
+      }
+      case Part::Done: break;
+    }
+    return reject(ValidationError::MalformedBlock);
+  }
+
+  // Transaction::serialize(false), fields in place. Its signing bytes are
+  // everything before the signature, then a zero signature length.
+  bool BlockStreamValidator::consume_transaction(std::span<const uint8_t> bytes) {
+    const size_t index = next_index_;
+    uint64_t nonce = 0;
+    std::span<const uint8_t> pubkey;
+    std::span<const uint8_t> signature;
+    size_t signed_bytes = 0;
+    try {
+      ByteReader reader(bytes);
+      const bool tagged = reader.read_u8() == 0xA1 && reader.read_u8() == 0x01 && reader.read_u32() == 1;
+      const uint32_t version = reader.read_u32();
+      nonce = reader.read_u64();
+      (void)reader.read_u64();  // amount
+      pubkey = reader.read_raw(reader.read_u32());
+      (void)reader.read_raw(reader.read_u32());  // to_label
+      signed_bytes = reader.position();
+      signature = reader.read_raw(reader.read_u32());
+      // Transaction::version is 16 bits wide.
+      if (!tagged || version > 0xFFFF || reader.remaining_bytes() != 0) {
+        return reject(ValidationError::MalformedBlock, index);
+      }
+    } catch (const SerializeError&) {
+      return reject(ValidationError::MalformedBlock, index);
+    }
+
+    if (is_genesis_candidate_) {
+      if ((index == 0) != pubkey.empty()) return reject(ValidationError::CoinBaseMisplaced, index);
+    } else if (pubkey.empty()) {
+      return reject(ValidationError::CoinbaseInNonGenesisBlock, index);
+    }
+
+    std::vector<uint8_t> message(bytes.begin(), bytes.begin() + signed_bytes);
+    message.insert(message.end(), sizeof(uint32_t), 0);
+    merkle_.add(sha256(std::span<const uint8_t>(message.data(), message.size())));
+
+    if (pubkey.empty()) return true;  // the genesis coinbase
+    if (nonces_ && !nonces_->next(hash160(pubkey), nonce)) return reject(ValidationError::ReplayedNonce, index);
+    dispatch({index, std::vector<uint8_t>(pubkey.begin(), pubkey.end()), std::move(message),
+              std::vector<uint8_t>(signature.begin(), signature.end())});
+
+    size_t bad_signature;
+    {
+      std::lock_guard lock(mutex_);
+      bad_signature = bad_signature_;
+    }
+    if (bad_signature != ~0ull) return reject(ValidationError::BadTransactionSignature, bad_signature);
+    return true;
+  }
+
+  ValidationResult BlockStreamValidator::finish() {
+    if (verdict_) return *verdict_;
+    if (part_ != Part::Done) {
+      reject(ValidationError::MalformedBlock, part_ == Part::Header || part_ == Part::Count ? ~0ull : next_index_);
+      return *verdict_;
+    }
+    size_t bad_signature;
+    {
+      ASTRO_TRACE_SPAN("validate.stream.wait");
+      std::unique_lock lock(mutex_);
+      room_cv_.wait(lock, [&] { return in_flight_ == 0; });
+      bad_signature = bad_signature_;
+    }
+    if (merkle_.root() != header_->merkle_root) {
+      reject(ValidationError::BadMerkleRoot);
+    } else if (bad_signature != ~0ull) {
+      reject(ValidationError::BadTransactionSignature, bad_signature);
+    } else {
+      verdict_ = ValidationResult{true, ValidationError::None, ~0ull};
+    }
+    return *verdict_;
+  }
+
+  // Drops the signature checks still queued; one already running finishes.
+  bool BlockStreamValidator::reject(ValidationError error, size_t index) {
+    if (!verdict_) verdict_ = ValidationResult{false, error, index};
+    std::lock_guard lock(mutex_);
+    in_flight_ -= queue_.size();
+    queue_.clear();
+    room_cv_.notify_all();
+    return false;
+  }
+
+  // Blocks while the queue is full, which keeps a fast sender from
+  // buffering a whole block's worth of checks.
+  void BlockStreamValidator::dispatch(SignatureCheck check) {
+    if (verifiers_.empty()) {
+      if (!verified(check.pubkey, check.message, check.signature)) record_bad_signature(check.index);
+      return;
+    }
+    {
+      std::unique_lock lock(mutex_);
+      room_cv_.wait(lock, [&] { return queue_.size() < 4 * verifiers_.size(); });
+      queue_.push_back(std::move(check));
+      ++in_flight_;
+    }
+    work_cv_.notify_one();
+  }
+
+  void BlockStreamValidator::run_verifier() {
+    ASTRO_TRACE_THREAD("stream-verifier");
+    for (;;) {
+      SignatureCheck check;
+      bool skip;
+      {
+        std::unique_lock lock(mutex_);
+        work_cv_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+        if (stopping_) return;
+        check = std::move(queue_.front());
+        queue_.pop_front();
+        // Past one that already failed, the verdict can't change.
+        skip = bad_signature_ < check.index;
+      }
+      room_cv_.notify_all();
+      if (!skip && !verified(check.pubkey, check.message, check.signature)) record_bad_signature(check.index);
+      std::lock_guard lock(mutex_);
+      --in_flight_;
+      room_cv_.notify_all();
+    }
+  }
+
+  void BlockStreamValidator::record_bad_signature(size_t index) {
+    std::lock_guard lock(mutex_);
+    bad_signature_ = std::min(bad_signature_, index);
+  }
+}
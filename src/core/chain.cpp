@@ -1,16 +1,185 @@
 #include "astro/core/chain.hpp"
 #include "astro/core/block.hpp"
+#include "astro/core/merkle.hpp"
+#include "astro/core/metrics.hpp"
 #include "astro/core/pow.hpp"
-#include "astro/storage/block_store.hpp"
+#include "astro/core/trace.hpp"
+#include "astro/storage/block_storage.hpp"
+#include "astro/storage/async_writer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 namespace astro::core {
   
-  Chain::Chain(ChainConfig config) : config_(config) {};
+  // A pruned block gives the ledger nothing to replay, so a tracked ledger
+  // couldn't be rebuilt on restore.
+  static void check_config(const ChainConfig& config) {
+    if (config.track_ledger && (config.keep_recent_bodies || config.body_byte_budget)) {
+      throw std::invalid_argument("Chain: track_ledger can't be combined with pruning");
+    }
+  }
+
+  Chain::Chain(ChainConfig config) : config_(config) {
+    check_config(config_);
+    views_.publish(config_.difficulty_bits);
+  }
+
+  Chain::Chain(ChainConfig config, astro::storage::BlockStorage& body_store)
+    : config_(config), body_store_(&body_store), bodies_(config.body_cache_blocks) {
+    check_config(config_);
+    views_.publish(config_.difficulty_bits);
+  }
+
+  void Chain::set_difficulty_bits(uint32_t bits) {
+    config_.difficulty_bits = bits;
+    views_.publish(bits);
+  }
+
+  std::optional<Hash256> ChainView::tip_hash() const {
+    if (height_ == 0) return std::nullopt;
+    return hash_at(height_ - 1);
+  }
+
+  ChainSnapshot ChainView::snapshot() const {
+    ChainSnapshot out;
+    out.headers.reserve(height_);
+    out.hashes.reserve(height_);
+    for (size_t h = 0; h < height_; ++h) {
+      out.headers.push_back(header_at(h));
+      out.hashes.push_back(hash_at(h));
+    }
+    return out;
+  }
+
+  static Block build_block_on(const Hash256* prev_hash, std::vector<Transaction> transactions, uint64_t timestamp) {
+    Block output;
+    output.transactions = std::move(transactions);
+    BlockHeader header;
+    header.version = 1;
+    if (prev_hash) header.prev_hash = *prev_hash;
+    header.merkle_root = compute_merkle_root(output.transactions);
+    header.timestamp = timestamp;
+    header.nonce = 0;
+    output.header = header;
+    return output;
+  }
+
+  Block ChainView::build_block_from_transactions(std::vector<Transaction> transactions, uint64_t timestamp) const {
+    return build_block_on(height_ == 0 ? nullptr : &hash_at(height_ - 1), std::move(transactions), timestamp);
+  }
+
+  // Fresh chunks holding the first `height` entries of `spine`.
+  static std::shared_ptr<const ChainView::Spine> copy_spine(const ChainView::Spine& spine, size_t height) {
+    auto out = std::make_shared<ChainView::Spine>();
+    for (size_t first = 0; first < height; first += ChainView::CHUNK_BLOCKS) {
+      const auto& from = *spine[first / ChainView::CHUNK_BLOCKS];
+      auto chunk = std::make_shared<ChainView::Chunk>();
+      const size_t count = std::min(ChainView::CHUNK_BLOCKS, height - first);
+      std::copy_n(from.headers.begin(), count, chunk->headers.begin());
+      std::copy_n(from.hashes.begin(), count, chunk->hashes.begin());
+      out->push_back(std::move(chunk));
+    }
+    return out;
+  }
+
+  Chain::ViewPublisher::ViewPublisher(const ViewPublisher& other)
+    : spine_(copy_spine(*other.spine_, other.height_)), height_(other.height_) {
+    publish(other.load()->difficulty_bits());
+  }
+
+  Chain::ViewPublisher& Chain::ViewPublisher::operator=(const ViewPublisher& other) {
+    if (this != &other) {
+      spine_ = copy_spine(*other.spine_, other.height_);
+      height_ = other.height_;
+      publish(other.load()->difficulty_bits());
+    }
+    return *this;
+  }
+
+  // The moved-from side is left empty, like the moved-from chain's blocks.
+  Chain::ViewPublisher::ViewPublisher(ViewPublisher&& other)
+    : spine_(std::exchange(other.spine_, std::make_shared<const ChainView::Spine>())),
+      height_(std::exchange(other.height_, 0)) {
+    std::lock_guard lock(other.mutex_);
+    view_ = std::exchange(other.view_, std::make_shared<const ChainView>());
+    published_height_.store(other.published_height_.exchange(0), std::memory_order_release);
+  }
+
+  Chain::ViewPublisher& Chain::ViewPublisher::operator=(ViewPublisher&& other) {
+    if (this != &other) {
+      spine_ = std::exchange(other.spine_, std::make_shared<const ChainView::Spine>());
+      height_ = std::exchange(other.height_, 0);
+      std::shared_ptr<const ChainView> view;
+      {
+        std::lock_guard lock(other.mutex_);
+        view = std::exchange(other.view_, std::make_shared<const ChainView>());
+        other.published_height_.store(0, std::memory_order_release);
+      }
+      std::lock_guard lock(mutex_);
+      view_.swap(view);
+      published_height_.store(height_, std::memory_order_release);
+    }
+    return *this;
+  }
+
+  std::shared_ptr<const ChainView> Chain::ViewPublisher::load() const {
+    std::lock_guard lock(mutex_);
+    return view_;
+  }
+
+  void Chain::ViewPublisher::append(const BlockHeader& header, const Hash256& hash) {
+    const size_t slot = height_ % ChainView::CHUNK_BLOCKS;
+    if (slot == 0) {
+      // Published spines are never modified; a new chunk means a new spine.
+      auto spine = std::make_shared<ChainView::Spine>(*spine_);
+      spine->push_back(std::make_shared<ChainView::Chunk>());
+      spine_ = std::move(spine);
+    }
+    auto& chunk = *spine_->back();
+    chunk.headers[slot] = header;
+    chunk.hashes[slot] = hash;
+    ++height_;
+  }
+
+  void Chain::ViewPublisher::truncate(size_t height) {
+    spine_ = copy_spine(*spine_, std::min(height, height_));
+    height_ = std::min(height, height_);
+  }
+
+  void Chain::ViewPublisher::publish(uint32_t difficulty_bits) {
+    auto view = std::make_shared<const ChainView>(spine_, height_, difficulty_bits);
+    {
+      std::lock_guard lock(mutex_);
+      view_.swap(view);
+    }
+    published_height_.store(height_, std::memory_order_release);
+    // The old view, if this held the last reference, is freed out here.
+  }
 
   std::optional<Hash256> Chain::tip_hash() const {
-    if (blocks_.empty()) return std::nullopt;
-    return blocks_.back().header.hash();
+    if (hashes_.empty()) return std::nullopt;
+    return hashes_.back();
+  }
+
+  std::optional<Hash256> Chain::hash_at(size_t height) const {
+    if (height >= hashes_.size()) return std::nullopt;
+    return hashes_[height];
+  }
+
+  std::optional<size_t> Chain::find_by_hash(const Hash256& hash) const {
+    auto it = heights_.find(hash);
+    if (it == heights_.end()) return std::nullopt;
+    return it->second;
   }
 
   const Block* Chain::block_at(size_t index) const {
@@ -23,14 +192,55 @@ namespace astro::core {
     return true;
   }
 
-  ValidationResult Chain::validate_block(const Block& block) const {
-    const bool is_genesis_candidate = blocks_.empty();
+  // Linkage and timestamp against `parent`, whose hash the caller supplies so
+  // cached hashes can be reused. No parent means the block would be genesis.
+  ValidationResult Chain::validate_link(const BlockHeader& header, const BlockHeader* parent, const Hash256& parent_hash) {
+    if (!parent) {
+      if (!is_zero_hash(header.prev_hash)) return {false, ValidationError::NonZeroPrevHashForGenesis, ~0ull};
+      return {true, ValidationError::None, ~0ull};
+    }
+    if (header.prev_hash != parent_hash) return {false, ValidationError::BadPrevLink, ~0ull};
+    if (header.timestamp < parent->timestamp) {
+      return {false, ValidationError::NonMonotonicTimestamp, ~0ull};
+    }
+    return {true, ValidationError::None, ~0ull};
+  }
 
-    if (is_genesis_candidate) {
-      if (!is_zero_hash(block.header.prev_hash)) {
-        return {false, ValidationError::NonZeroPrevHashForGenesis, ~0ull};
+  ValidationResult Chain::validate_pow(const Hash256& header_hash, bool is_genesis_candidate) const {
+    if (config_.difficulty_bits > 0 && (!is_genesis_candidate || config_.enforce_genesis_pow)) {
+      if (!pow::meets_difficulty(config_.difficulty_bits, header_hash)) {
+        return {false, ValidationError::InsufficientPOW, ~0ull};
       }
+    }
+    return {true, ValidationError::None, ~0ull};
+  }
 
+  // Runs one validation stage, adding its outcome to `stage`. With
+  // ASTRO_METRICS, one pair of clock reads times it for both `stage` and
+  // the `timer` histogram; without, no clock is read and nanos stays zero.
+  template <class Check>
+  static ValidationResult timed(ValidationStats::Stage& stage, [[maybe_unused]] metrics::Timer timer, Check&& check) {
+#ifdef ASTRO_METRICS
+    const auto t0 = std::chrono::steady_clock::now();
+    auto result = check();
+    const uint64_t nanos =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    stage.nanos += nanos;
+    metrics::record(timer, nanos);
+#else
+    auto result = check();
+#endif
+    ++stage.runs;
+    if (!result.is_valid) ++stage.rejected;
+    return result;
+  }
+
+  // Coinbase placement and merkle root: one hash per transaction, far
+  // cheaper than the signatures, which wait until this has passed.
+  ValidationResult Chain::validate_structure(const Block& block, bool is_genesis_candidate,
+                                             std::vector<Hash256>* tx_hashes) {
+    ASTRO_TRACE_SPAN("validate.structure");
+    if (is_genesis_candidate) {
       if (!block.transactions.empty()) {
         if (!block.transactions.front().from_pub_pem.empty()) {
           return {false, ValidationError::CoinBaseMisplaced, 0};
@@ -40,25 +250,23 @@ namespace astro::core {
         }
       }
     } else {
-      auto parent_hash = blocks_.back().header.hash();
-      if (block.header.prev_hash != parent_hash) {
-        return {false, ValidationError::BadPrevLink, ~0ull};
-      }
-
-      if (block.header.timestamp < blocks_.back().header.timestamp) {
-        return {false, ValidationError::NonMonotonicTimestamp, ~0ull};
-      }
-  
       for (size_t i = 0; i < block.transactions.size(); ++i) {
         if (block.transactions[i].from_pub_pem.empty()) return {false, ValidationError::CoinbaseInNonGenesisBlock, i};
       }
     }
 
-    auto computed_merkle_root = compute_merkle_root(block.transactions);
-    if (computed_merkle_root!= block.header.merkle_root) {
+    std::vector<Hash256> leaves;
+    leaves.reserve(block.transactions.size());
+    for (const auto& tx : block.transactions) leaves.push_back(tx.tx_hash());
+    if (root(leaves) != block.header.merkle_root) {
       return {false, ValidationError::BadMerkleRoot, ~0ull};
     }
+    if (tx_hashes) *tx_hashes = std::move(leaves);
+    return {true, ValidationError::None, ~0ull};
+  }
 
+  ValidationResult Chain::validate_signatures(const Block& block, bool is_genesis_candidate) {
+    ASTRO_TRACE_SPAN("validate.signatures");
     for (size_t i = 0; i < block.transactions.size(); ++i) {
       const auto& tx =  block.transactions[i];
       // Skip signature verification for an allowed coinbase at genesis (empty from_pub_pem)
@@ -67,58 +275,614 @@ namespace astro::core {
         return {false, ValidationError::BadTransactionSignature, i};
       }
     }
+    return {true, ValidationError::None, ~0ull};
+  }
 
-    if (config_.difficulty_bits > 0) {
-      if (is_genesis_candidate && !config_.enforce_genesis_pow) {
-        // No POW check for genesis block if not enforced
-      } else {
-        auto header_hash = block.header.hash();
-        if (!pow::meets_difficulty(config_.difficulty_bits, header_hash)) {
-          return {false, ValidationError::InsufficientPOW, ~0ull};
-        }
-      }
+  // Both body stages. Needs no chain state beyond whether the block would be
+  // genesis, so restore runs it in parallel. Hands back the transaction
+  // hashes the merkle check computed through `tx_hashes`, when given.
+  ValidationResult Chain::validate_body(const Block& block, bool is_genesis_candidate, bool check_signatures,
+                                        std::vector<Hash256>* tx_hashes) {
+    // Outside timed(), so the histograms are fed here.
+    auto result = [&] {
+      ASTRO_METRICS_TIMER(metrics::Timer::ValidateStructure);
+      return validate_structure(block, is_genesis_candidate, tx_hashes);
+    }();
+    if (!result.is_valid || !check_signatures) return result;
+    ASTRO_METRICS_TIMER(metrics::Timer::ValidateSignatures);
+    return validate_signatures(block, is_genesis_candidate);
+  }
+
+  // Linkage, timestamp and PoW: everything that can be checked without the
+  // body. The header is only hashed when PoW is enforced or `hash_out` wants it.
+  ValidationResult Chain::validate_header_after(const BlockHeader& header, const BlockHeader* parent,
+                                                const Hash256& parent_hash, Hash256* hash_out) const {
+    ASTRO_TRACE_SPAN("validate.header");
+    auto result = validate_link(header, parent, parent_hash);
+    if (!result.is_valid) return result;
+    if (config_.difficulty_bits == 0 && !hash_out) return result;
+    const Hash256 hash = header.hash();
+    if (hash_out) *hash_out = hash;
+    return validate_pow(hash, parent == nullptr);
+  }
+
+  ValidationResult Chain::validate_header(const BlockHeader& header) const {
+    return timed(stats_.header, metrics::Timer::ValidateHeader, [&] {
+      return validate_header_after(header, tip_header(), hashes_.empty() ? Hash256{} : hashes_.back(), nullptr);
+    });
+  }
+
+  ValidationResult Chain::validate_headers(std::span<const BlockHeader> headers, size_t* valid) const {
+    const BlockHeader* parent = tip_header();
+    Hash256 parent_hash = hashes_.empty() ? Hash256{} : hashes_.back();
+    ValidationResult result{true, ValidationError::None, ~0ull};
+    size_t checked = 0;
+    for (; checked < headers.size(); ++checked) {
+      Hash256 hash;
+      result = timed(stats_.header, metrics::Timer::ValidateHeader, [&] { return validate_header_after(headers[checked], parent, parent_hash, &hash); });
+      if (!result.is_valid) break;
+      parent = &headers[checked];
+      parent_hash = hash;
+    }
+    if (valid) *valid = checked;
+    return result;
+  }
+
+  ValidationResult Chain::validate_block(const Block& block) const {
+    auto result = validate_block_after(block, tip_header(), hashes_.empty() ? Hash256{} : hashes_.back(), nullptr);
+    size_t bad_tx = ~0ull;
+    if (result.is_valid && config_.track_ledger && !ledger_.check(block, &bad_tx)) {
+      return {false, ValidationError::ReplayedNonce, bad_tx};
+    }
+    return result;
+  }
+
+  // The ledger half of validation; a no-op without track_ledger.
+  ValidationResult Chain::apply_to_ledger(const Block& block, Ledger::Undo* undo) {
+    size_t bad_tx = ~0ull;
+    if (config_.track_ledger && !ledger_.apply(block, undo, &bad_tx)) {
+      return {false, ValidationError::ReplayedNonce, bad_tx};
     }
     return {true, ValidationError::None, ~0ull};
   }
 
+  // From the stored bodies, for when a snapshot's ledger turns out not to
+  // match the restored chain.
+  void Chain::rebuild_ledger(astro::storage::BlockStorage& store) {
+    if (store.pruned_height() > 0) throw std::runtime_error("Chain: can't rebuild the ledger from pruned bodies");
+    ledger_ = Ledger{};
+    if (blocks_.empty()) return;
+    // Stops at the tip without decoding the record after it, which may be
+    // the one a failed restore couldn't read.
+    size_t height = 0;
+    store.load_blocks([&](Block&& block) {
+      ledger_.apply(block);
+      return ++height < blocks_.size();
+    });
+  }
+
+  // validate_block against an arbitrary parent, so a batch can be checked
+  // before any of it is appended. Stores the block's hash in `hash_out` when
+  // it had to be computed anyway.
+  ValidationResult Chain::validate_block_after(const Block& block, const BlockHeader* parent, const Hash256& parent_hash,
+                                               Hash256* hash_out, std::vector<Hash256>* tx_hashes_out) const {
+    const bool is_genesis_candidate = parent == nullptr;
+    auto result = timed(stats_.header, metrics::Timer::ValidateHeader, [&] { return validate_header_after(block.header, parent, parent_hash, hash_out); });
+    if (!result.is_valid) return result;
+    result = timed(stats_.structure, metrics::Timer::ValidateStructure, [&] { return validate_structure(block, is_genesis_candidate, tx_hashes_out); });
+    if (!result.is_valid) return result;
+    return timed(stats_.signatures, metrics::Timer::ValidateSignatures, [&] { return validate_signatures(block, is_genesis_candidate); });
+  }
+
+  // Serialized size of the transactions, as in Block::serialize().
+  static uint64_t body_bytes(const Block& block) {
+    uint64_t bytes = sizeof(uint32_t);
+    for (const auto& tx : block.transactions) {
+      // length prefix, tag/schema, version, nonce, amount, three field lengths
+      bytes += 4 + 6 + 4 + 8 + 8 + 3 * 4 + tx.from_pub_pem.size() + tx.to_label.size() + tx.signature.size();
+    }
+    return bytes;
+  }
+
+  // For the appends; blocks a restore brings back don't count.
+  static void count_accepted([[maybe_unused]] const Block& block) {
+    ASTRO_METRICS_ADD(metrics::Counter::BlocksAccepted, 1);
+    ASTRO_METRICS_ADD(metrics::Counter::TransactionsAccepted, block.transactions.size());
+  }
+
+  void Chain::push_block(Block block, const Hash256& hash, std::vector<Hash256> tx_hashes) {
+    index_transactions(blocks_.size(), block, std::move(tx_hashes));
+    body_bytes_ += body_bytes(block);
+    blocks_.push_back(std::move(block));
+    index_hash(hash);
+    enforce_retention();
+  }
+
+  void Chain::index_hash(const Hash256& hash) {
+    heights_.emplace(hash, hashes_.size());
+    hashes_.push_back(hash);
+    views_.append(blocks_.back().header, hash);
+    views_.publish(config_.difficulty_bits);
+  }
+
+  // `tx_hashes` may be empty, in which case they are computed here.
+  void Chain::index_transactions(size_t height, const Block& block, std::vector<Hash256> tx_hashes) {
+    if (!config_.index_transactions) return;
+    if (tx_hashes.size() != block.transactions.size()) {
+      tx_hashes.clear();
+      for (const auto& tx : block.transactions) tx_hashes.push_back(tx.tx_hash());
+    }
+    // The first confirmation wins if the same transaction shows up again.
+    for (size_t i = 0; i < tx_hashes.size(); ++i) {
+      tx_index_.emplace(tx_hashes[i], TxPosition{height, static_cast<uint32_t>(i)});
+    }
+  }
+
+  std::optional<TxInclusion> Chain::find_transaction(const Hash256& tx_hash) const {
+    auto it = tx_index_.find(tx_hash);
+    if (it == tx_index_.end()) return std::nullopt;
+    TxInclusion out{it->second.height, it->second.index, std::nullopt};
+    auto block = get_block(out.height);
+    if (block && out.index < block->transactions.size()) {
+      std::vector<Hash256> leaves;
+      leaves.reserve(block->transactions.size());
+      for (const auto& tx : block->transactions) leaves.push_back(tx.tx_hash());
+      out.proof = build_proof(leaves, out.index);
+    }
+    return out;
+  }
+
+  void Chain::enforce_retention() {
+    // A paged chain keeps only the tip's body unless told to keep more.
+    const size_t keep = config_.keep_recent_bodies ? config_.keep_recent_bodies : body_store_ ? 1 : 0;
+    if (keep == 0 && config_.body_byte_budget == 0) return;
+    while (pruned_ + 1 < blocks_.size()) {
+      const bool over_count = keep && blocks_.size() - pruned_ > keep;
+      const bool over_bytes = config_.body_byte_budget && body_bytes_ > config_.body_byte_budget;
+      if (!over_count && !over_bytes) break;
+      auto& pruned = blocks_[pruned_];
+      body_bytes_ -= body_bytes(pruned);
+      // Recently evicted bodies are the likeliest to be asked for, and may
+      // not have reached the store yet when appends are asynchronous.
+      if (body_store_) {
+        auto body = std::make_shared<const Block>(Block{pruned.header, std::move(pruned.transactions)});
+        if (pruned_ >= unsynced_from_ && pruned_ < unsynced_to_) unsynced_bodies_.emplace(pruned_, std::move(body));
+        else bodies_.put(pruned_, std::move(body));
+      }
+      std::vector<Transaction>().swap(pruned.transactions);
+      ++pruned_;
+    }
+  }
+
+  std::shared_ptr<const Block> Chain::get_block(size_t height) const {
+    if (height >= blocks_.size()) return nullptr;
+    if (height >= pruned_ || !body_store_) return std::make_shared<const Block>(blocks_[height]);
+    if (auto it = unsynced_bodies_.find(height); it != unsynced_bodies_.end()) return it->second;
+    if (auto cached = bodies_.find(height)) {
+      ASTRO_METRICS_ADD(metrics::Counter::BodyCacheHits, 1);
+      return *cached;
+    }
+    ASTRO_METRICS_ADD(metrics::Counter::BodyCacheMisses, 1);
+    auto block = std::make_shared<const Block>(Block{blocks_[height].header, body_store_->read_body(height)});
+    bodies_.put(height, block);
+    return block;
+  }
+
   ValidationResult Chain::append_block(const Block& block) {
-    auto validation_result = validate_block(block);
+    Hash256 hash;
+    std::vector<Hash256> tx_hashes;
+    auto validation_result = validate_block_after(block, tip_header(), hashes_.empty() ? Hash256{} : hashes_.back(),
+                                                  &hash, &tx_hashes);
     if (!validation_result.is_valid) return validation_result;
-    blocks_.push_back(block);
+    auto ledger_result = apply_to_ledger(block, nullptr);
+    if (!ledger_result.is_valid) return ledger_result;
+    push_block(block, hash, std::move(tx_hashes));
+    count_accepted(block);
     return validation_result;
   }
 
-  void Chain::restore_from_store(astro::storage::BlockStore& store) {
-    auto stored_blocks = store.load_all_blocks();
-    for (const auto& block : stored_blocks) {
-      auto validation_result = append_block(block);
-      if (!validation_result.is_valid) break;
+  ChainSnapshot Chain::snapshot() const {
+    ChainSnapshot out;
+    out.headers.reserve(blocks_.size());
+    for (const auto& block : blocks_) out.headers.push_back(block.header);
+    out.hashes = hashes_;
+    out.has_tx_index = config_.index_transactions;
+    out.transactions.reserve(tx_index_.size());
+    for (const auto& [tx_hash, position] : tx_index_) {
+      out.transactions.push_back({tx_hash, position.height, position.index});
     }
+    if (config_.track_ledger) out.ledger = ledger_;
+    return out;
   }
 
-  ValidationResult Chain::append_and_store(const Block& block, astro::storage::BlockStore& store) {
-    auto validation_result = validate_block(block);
+  void Chain::restore_from_store(astro::storage::BlockStorage& store, const ChainSnapshot* snapshot) {
+    const size_t base = blocks_.size();
+    // Snapshot heights only line up with the store when restoring from scratch.
+    if (base != 0 || (snapshot && snapshot->headers.size() != snapshot->hashes.size())) snapshot = nullptr;
+    const bool assume_valid = !config_.force_full_verification
+      && (config_.assume_valid_height || config_.assume_valid_hash);
+    const Ledger ledger_before = ledger_;
+    if (restore_blocks(store, assume_valid, snapshot)) return;
+
+    // The checkpoint is not on the stored chain, so the skipped signatures
+    // can't be trusted: start over and check all of them.
+    for (size_t h = base; h < hashes_.size(); ++h) heights_.erase(hashes_[h]);
+    std::erase_if(tx_index_, [&](const auto& entry) { return entry.second.height >= base; });
+    ledger_ = ledger_before;
+    views_.truncate(base);
+    views_.publish(config_.difficulty_bits);
+    blocks_.resize(base);
+    bodies_.clear();
+    hashes_.resize(base);
+    pruned_ = std::min(pruned_, base);
+    body_bytes_ = 0;
+    for (size_t h = pruned_; h < base; ++h) body_bytes_ += body_bytes(blocks_[h]);
+    restore_blocks(store, false, snapshot);
+  }
+
+  // Four stages: a reader thread streams and checksums records, a pool of
+  // workers hashes headers, checks PoW and runs validate_body() on batches,
+  // and this thread checks linkage, timestamps and PoW in order and commits.
+  // Returns false if signatures were skipped for an assume-valid checkpoint
+  // that the restored chain turned out not to contain.
+  bool Chain::restore_blocks(astro::storage::BlockStorage& store, bool assume_valid, const ChainSnapshot* snapshot) {
+    constexpr size_t BATCH_BLOCKS = 32;
+    // BODY_TRUSTED: header matches the snapshot, so the body was validated
+    // before it was written.
+    enum : uint8_t { BODY_INVALID, BODY_VALID, BODY_UNSIGNED, BODY_TRUSTED };
+    const size_t covered = snapshot ? snapshot->headers.size() : 0;
+    struct Batch {
+      uint64_t first = 0;  // store index of blocks[0]
+      std::vector<Block> blocks;
+      std::vector<Hash256> hashes;
+      std::vector<uint8_t> body;
+      std::vector<std::vector<Hash256>> tx_hashes;  // when indexing
+    };
+
+    const uint64_t headers_only = store.pruned_height();
+    const size_t base = blocks_.size();
+    const auto& checkpoint_hash = config_.assume_valid_hash;
+    const auto& checkpoint_height = config_.assume_valid_height;
+    // Height of the checkpoint once it is known to be on this chain. A bare
+    // height is taken on trust; a hash has to be seen first.
+    std::optional<uint64_t> confirmed;
+    if (assume_valid && !checkpoint_hash) confirmed = checkpoint_height;
+    // Workers skip signatures at or below this height. Without a height it
+    // starts unbounded and drops to the checkpoint once the hash shows up.
+    std::atomic<uint64_t> skip_through{checkpoint_height.value_or(~0ull)};
+    // Index entries of trusted blocks come from the snapshot by height.
+    const bool indexing = config_.index_transactions;
+    std::vector<std::vector<std::pair<Hash256, uint32_t>>> snapshot_txs;
+    if (indexing && snapshot && snapshot->has_tx_index) {
+      snapshot_txs.resize(covered);
+      for (const auto& entry : snapshot->transactions) {
+        if (entry.height < covered) snapshot_txs[entry.height].emplace_back(entry.tx_hash, entry.index);
+      }
+    }
+    // A snapshot's ledger stands for its first `covered` blocks as long as
+    // the store has the same ones; otherwise it is rebuilt afterwards.
+    const bool tracking = config_.track_ledger;
+    const bool ledger_from_snapshot = tracking && snapshot && snapshot->ledger;
+    bool ledger_stale = false;
+    if (tracking && headers_only > 0 && !(ledger_from_snapshot && headers_only <= covered)) {
+      throw std::runtime_error("Chain: can't rebuild the ledger from pruned bodies");
+    }
+    if (ledger_from_snapshot) ledger_ = *snapshot->ledger;
+    const size_t workers = config_.restore_threads
+      ? config_.restore_threads
+      : std::max<size_t>(1, std::thread::hardware_concurrency());
+    // Batches read but not yet committed; bounds memory when the verifiers
+    // or the commit stage fall behind the reader.
+    const size_t max_in_flight = 4 * workers;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Batch> parsed;
+    std::map<uint64_t, Batch> verified;
+    size_t in_flight = 0;
+    bool reading_done = false;
+    bool stop = false;
+    std::exception_ptr read_error;
+
+    std::thread reader([&] {
+      ASTRO_TRACE_THREAD("restore-reader");
+      Batch batch;
+      uint64_t index = 0;
+      auto flush = [&] {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&] { return stop || in_flight < max_in_flight; });
+        if (stop) return false;
+        ++in_flight;
+        parsed.push_back(std::move(batch));
+        batch = Batch{};
+        cv.notify_all();
+        return true;
+      };
+      try {
+        store.load_blocks([&](Block&& block) {
+          if (batch.blocks.empty()) batch.first = index;
+          batch.blocks.push_back(std::move(block));
+          ++index;
+          return batch.blocks.size() < BATCH_BLOCKS || flush();
+        });
+      } catch (...) {
+        std::lock_guard lock(mutex);
+        read_error = std::current_exception();
+      }
+      // Blocks read before a failure are still restored.
+      if (!batch.blocks.empty()) flush();
+      std::lock_guard lock(mutex);
+      reading_done = true;
+      cv.notify_all();
+    });
+
+    auto verify = [&] {
+      ASTRO_TRACE_THREAD("restore-worker");
+      for (;;) {
+        Batch batch;
+        {
+          std::unique_lock lock(mutex);
+          cv.wait(lock, [&] { return stop || !parsed.empty() || reading_done; });
+          if (stop || parsed.empty()) return;
+          batch = std::move(parsed.front());
+          parsed.pop_front();
+        }
+        ASTRO_TRACE_SPAN("restore.verify");
+        batch.hashes.resize(batch.blocks.size());
+        batch.body.resize(batch.blocks.size());
+        if (indexing) batch.tx_hashes.resize(batch.blocks.size());
+        for (size_t i = 0; i < batch.blocks.size(); ++i) {
+          const uint64_t index = batch.first + i;
+          const uint64_t height = base + index;
+          if (height < covered && batch.blocks[i].header == snapshot->headers[height]) {
+            batch.hashes[i] = snapshot->hashes[height];
+            batch.body[i] = BODY_TRUSTED;
+            if (indexing && snapshot_txs.empty()) {
+              for (const auto& tx : batch.blocks[i].transactions) batch.tx_hashes[i].push_back(tx.tx_hash());
+            }
+            continue;
+          }
+          batch.hashes[i] = batch.blocks[i].header.hash();
+          if (index < headers_only) {
+            batch.body[i] = BODY_VALID;
+            continue;
+          }
+          // PoW first: a block that fails it costs no merkle or signature work.
+          if (!validate_pow(batch.hashes[i], height == 0).is_valid) {
+            batch.body[i] = BODY_INVALID;
+            continue;
+          }
+          const bool check_signatures = !assume_valid || height > skip_through.load(std::memory_order_relaxed);
+          bool ok = false;
+          try {
+            ok = validate_body(batch.blocks[i], height == 0, check_signatures,
+                               indexing ? &batch.tx_hashes[i] : nullptr).is_valid;
+          } catch (const std::exception&) {
+            // A stored key that doesn't parse makes verify() throw.
+          }
+          batch.body[i] = !ok ? BODY_INVALID : check_signatures ? BODY_VALID : BODY_UNSIGNED;
+        }
+        std::lock_guard lock(mutex);
+        verified.emplace(batch.first / BATCH_BLOCKS, std::move(batch));
+        cv.notify_all();
+      }
+    };
+    std::vector<std::thread> pool;
+    // Stops and joins the reader and workers however the commit loop below
+    // ends, so a throw from it never unwinds past a joinable thread.
+    struct Joiner {
+      std::mutex& mutex;
+      std::condition_variable& cv;
+      bool& stop;
+      std::thread& reader;
+      std::vector<std::thread>& pool;
+      ~Joiner() {
+        {
+          std::lock_guard lock(mutex);
+          stop = true;
+          cv.notify_all();
+        }
+        reader.join();
+        for (auto& worker : pool) worker.join();
+      }
+    };
+    std::optional<Joiner> joiner;
+    joiner.emplace(mutex, cv, stop, reader, pool);
+    for (size_t i = 0; i < workers; ++i) pool.emplace_back(verify);
+
+    Hash256 parent = hashes_.empty() ? Hash256{} : hashes_.back();
+    bool unconfirmed = false;  // signatures skipped below a checkpoint not yet seen
+    bool checkpoint_missed = false;
+    for (uint64_t next = 0;; ++next) {
+      Batch batch;
+      {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&] { return verified.count(next) || (reading_done && in_flight == 0); });
+        auto it = verified.find(next);
+        if (it == verified.end()) break;
+        batch = std::move(it->second);
+        verified.erase(it);
+      }
+      ASTRO_TRACE_SPAN("restore.commit");
+      bool valid = true;
+      for (size_t i = 0; i < batch.blocks.size(); ++i) {
+        auto& block = batch.blocks[i];
+        const uint64_t height = blocks_.size();
+        if (batch.body[i] == BODY_UNSIGNED) {
+          // Workers may run past the checkpoint before they learn where it is.
+          if (confirmed && height > *confirmed) {
+            try {
+              if (!validate_body(block, height == 0).is_valid) batch.body[i] = BODY_INVALID;
+            } catch (const std::exception&) {
+              batch.body[i] = BODY_INVALID;
+            }
+          } else if (!confirmed) {
+            unconfirmed = true;
+          }
+        }
+        if (batch.body[i] == BODY_INVALID || !validate_link(block.header, tip_header(), parent).is_valid
+            || !validate_pow(batch.hashes[i], blocks_.empty()).is_valid) {
+          valid = false;
+          break;
+        }
+        if (assume_valid && !confirmed && checkpoint_hash && (!checkpoint_height || height == *checkpoint_height)) {
+          if (batch.hashes[i] == *checkpoint_hash) {
+            confirmed = height;
+            skip_through.store(height, std::memory_order_relaxed);
+          } else if (checkpoint_height) {
+            checkpoint_missed = true;
+            valid = false;
+            break;
+          }
+        }
+        if (ledger_from_snapshot && height < covered) {
+          if (batch.body[i] != BODY_TRUSTED) ledger_stale = true;
+        } else if (tracking && !ledger_stale && !apply_to_ledger(block, nullptr).is_valid) {
+          valid = false;
+          break;
+        }
+        std::vector<Hash256> tx_hashes = indexing ? std::move(batch.tx_hashes[i]) : std::vector<Hash256>{};
+        if (batch.body[i] == BODY_TRUSTED && !snapshot_txs.empty()) {
+          // A block whose entries don't all come back (a repeated tx) is hashed instead.
+          tx_hashes.assign(block.transactions.size(), Hash256{});
+          size_t found = 0;
+          for (const auto& [tx_hash, position] : snapshot_txs[height]) {
+            if (position < tx_hashes.size()) {
+              tx_hashes[position] = tx_hash;
+              ++found;
+            }
+          }
+          if (found != tx_hashes.size()) tx_hashes.clear();
+        }
+        if (batch.first + i < headers_only) {
+          // Only a leading run of header-only blocks counts as pruned.
+          if (pruned_ == blocks_.size()) ++pruned_;
+          blocks_.push_back(std::move(block));
+          index_hash(batch.hashes[i]);
+        } else {
+          push_block(std::move(block), batch.hashes[i], std::move(tx_hashes));
+        }
+        parent = batch.hashes[i];
+      }
+      std::lock_guard lock(mutex);
+      --in_flight;
+      if (!valid) break;
+      cv.notify_all();
+    }
+
+    joiner.reset();
+    const bool trusted = !checkpoint_missed && !(unconfirmed && !confirmed);
+    if (trusted) {
+      if (ledger_from_snapshot && blocks_.size() < covered) ledger_stale = true;
+      if (ledger_stale) rebuild_ledger(store);
+    }
+    // A read error is only passed on once the blocks restored before it can
+    // stand; an untrusted run is redone with full checks, which throws it.
+    if (read_error && trusted) std::rethrow_exception(read_error);
+    return trusted;
+  }
+
+  // Runs once the blocks are durable, so a compaction that fails (a full
+  // disk, say) doesn't fail the append. The store keeps the bodies until
+  // the next append asks again.
+  static void prune_store(astro::storage::BlockStorage& store, size_t height) {
+    try {
+      store.prune_bodies(height);
+    } catch (const std::exception&) {
+      ASTRO_METRICS_ADD(metrics::Counter::StorePruneFailures, 1);
+    }
+  }
+
+  ValidationResult Chain::append_and_store(const Block& block, astro::storage::BlockStorage& store) {
+    Hash256 hash;
+    std::vector<Hash256> tx_hashes;
+    auto validation_result = validate_block_after(block, tip_header(), hashes_.empty() ? Hash256{} : hashes_.back(),
+                                                  &hash, &tx_hashes);
     if (!validation_result.is_valid) return validation_result;
+    Ledger::Undo undo;
+    auto ledger_result = apply_to_ledger(block, &undo);
+    if (!ledger_result.is_valid) return ledger_result;
     try {
       store.append_block(block);
     } catch (...) {
+      ledger_.undo(undo);
       return {false, ValidationError::None, ~0ull};
     }
-    blocks_.push_back(block);
+    push_block(block, hash, std::move(tx_hashes));
+    count_accepted(block);
+    if (pruned_ > 0 && !body_store_) prune_store(store, pruned_);
     return validation_result;
   }
 
+  BatchAppendResult Chain::append_blocks(std::span<const Block> blocks, astro::storage::BlockStorage& store) {
+    // Validate the whole batch first, each block against the one before it,
+    // and keep the valid prefix.
+    std::vector<Hash256> hashes(blocks.size());
+    std::vector<std::vector<Hash256>> tx_hashes(blocks.size());
+    std::vector<Ledger::Undo> undos(blocks.size());
+    BatchAppendResult result{0, {true, ValidationError::None, ~0ull}};
+    const BlockHeader* parent = tip_header();
+    Hash256 parent_hash = hashes_.empty() ? Hash256{} : hashes_.back();
+    size_t valid = 0;
+    try {
+      for (; valid < blocks.size(); ++valid) {
+        result.validation = validate_block_after(blocks[valid], parent, parent_hash, &hashes[valid], &tx_hashes[valid]);
+        if (!result.validation.is_valid) break;
+        // The ledger moves ahead with the batch; the undo records take it
+        // back if the store write fails.
+        result.validation = apply_to_ledger(blocks[valid], &undos[valid]);
+        if (!result.validation.is_valid) break;
+        parent = &blocks[valid].header;
+        parent_hash = hashes[valid];
+      }
+    } catch (...) {
+      for (size_t i = valid; i-- > 0;) ledger_.undo(undos[i]);
+      throw;
+    }
+    if (valid == 0) return result;
+
+    // One write and one fsync for all of it.
+    try {
+      store.append_blocks(blocks.first(valid));
+    } catch (...) {
+      for (size_t i = valid; i-- > 0;) ledger_.undo(undos[i]);
+      return {0, {false, ValidationError::None, ~0ull}};
+    }
+    for (size_t i = 0; i < valid; ++i) {
+      push_block(blocks[i], hashes[i], std::move(tx_hashes[i]));
+      count_accepted(blocks[i]);
+    }
+    if (pruned_ > 0 && !body_store_) prune_store(store, pruned_);
+    result.appended = valid;
+    return result;
+  }
+
+  AsyncAppendResult Chain::append_and_store_async(const Block& block, astro::storage::AsyncBlockWriter& writer) {
+    Hash256 hash;
+    std::vector<Hash256> tx_hashes;
+    auto validation_result = validate_block_after(block, tip_header(), hashes_.empty() ? Hash256{} : hashes_.back(),
+                                                  &hash, &tx_hashes);
+    if (!validation_result.is_valid) return {validation_result, {}};
+    auto ledger_result = apply_to_ledger(block, nullptr);
+    if (!ledger_result.is_valid) return {ledger_result, {}};
+    if (unsynced_from_ == unsynced_to_) unsynced_from_ = blocks_.size();
+    unsynced_to_ = blocks_.size() + 1;
+    push_block(block, hash, std::move(tx_hashes));
+    count_accepted(block);
+    return {validation_result, writer.enqueue(block)};
+  }
+
+  void Chain::mark_durable(size_t height) {
+    unsynced_from_ = std::clamp(height, unsynced_from_, unsynced_to_);
+    // Recently evicted, so they go to the front of the cache.
+    while (!unsynced_bodies_.empty() && unsynced_bodies_.begin()->first < unsynced_from_) {
+      auto node = unsynced_bodies_.extract(unsynced_bodies_.begin());
+      bodies_.put(node.key(), std::move(node.mapped()));
+    }
+  }
+
   Block Chain::build_block_from_transactions(std::vector<Transaction> transactions, uint64_t timestamp) const {
-    Block output;
-    output.transactions = std::move(transactions);
-    BlockHeader header;
-    header.version = 1;
-    if (!blocks_.empty()) header.prev_hash = blocks_.back().header.hash();
-    header.merkle_root = compute_merkle_root(output.transactions);
-    header.timestamp = timestamp;
-    header.nonce = 0;
-    output.header = header;
-    return output;
+    return build_block_on(hashes_.empty() ? nullptr : &hashes_.back(), std::move(transactions), timestamp);
   }
 
 
@@ -0,0 +1,223 @@
+#include "astro/storage/chain_snapshot.hpp"
+#include "astro/core/crc32c.hpp"
+#include "astro/core/serializer.hpp"
+#include "astro/core/trace.hpp"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+  #include <unistd.h>
+  #include <fcntl.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace astro::core;
+
+namespace astro::storage {
+  static constexpr uint32_t SNAPSHOT_MAGIC = 0x504E5341;  // "ASNP"
+  // Version 2 appends the transaction index and version 3 the ledger; older
+  // files still load.
+  static constexpr uint32_t SNAPSHOT_VERSION = 3;
+
+  #ifndef _WIN32
+    static void write_file_synced(const fs::path& path, std::span<const uint8_t> bytes) {
+      int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+      if (fd < 0) throw std::system_error(errno, std::generic_category(), "ChainSnapshot: open failed");
+      auto fail = [fd](const char* what) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), what);
+      };
+      size_t done = 0;
+      while (done < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n < 0) {
+          if (errno == EINTR) continue;
+          fail("ChainSnapshot: write failed");
+        }
+        done += static_cast<size_t>(n);
+      }
+      if (::fsync(fd) != 0) fail("ChainSnapshot: fsync failed");
+      ::close(fd);
+    }
+
+    static void fsync_directory(const fs::path& dir) {
+      int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+      if (fd < 0) throw std::system_error(errno, std::generic_category(), "ChainSnapshot: open dir failed");
+      int rc = ::fsync(fd);
+      int err = errno;
+      ::close(fd);
+      if (rc != 0) throw std::system_error(err, std::generic_category(), "ChainSnapshot: fsync dir failed");
+    }
+  #else
+    static void write_file_synced(const fs::path& path, std::span<const uint8_t> bytes) {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+      out.flush();
+      if (!out.good()) throw std::runtime_error("ChainSnapshot: write failed");
+    }
+
+    static void fsync_directory(const fs::path&) {}
+  #endif
+
+  void write_chain_snapshot(const fs::path& path, const ChainSnapshot& snapshot) {
+    if (snapshot.headers.size() != snapshot.hashes.size()) {
+      throw std::invalid_argument("ChainSnapshot: headers and hashes differ in length");
+    }
+    ByteWriter writer;
+    writer.write_u32(SNAPSHOT_MAGIC);
+    writer.write_u32(SNAPSHOT_VERSION);
+    writer.write_u64(snapshot.headers.size());
+    for (size_t i = 0; i < snapshot.headers.size(); ++i) {
+      writer.write_raw(snapshot.headers[i].serialize());
+      writer.write_raw(snapshot.hashes[i]);
+    }
+    writer.write_u8(snapshot.has_tx_index ? 1 : 0);
+    if (snapshot.has_tx_index) {
+      writer.write_u64(snapshot.transactions.size());
+      for (const auto& entry : snapshot.transactions) {
+        writer.write_raw(entry.tx_hash);
+        writer.write_varint(entry.height);
+        writer.write_varint(entry.index);
+      }
+    }
+    writer.write_u8(snapshot.ledger ? 1 : 0);
+    if (snapshot.ledger) snapshot.ledger->write(writer);
+    writer.write_u32(crc32c(writer.buffer()));
+
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    try {
+      write_file_synced(tmp_path, writer.buffer());
+      fs::rename(tmp_path, path);
+    } catch (...) {
+      std::error_code ec;
+      fs::remove(tmp_path, ec);
+      throw;
+    }
+    fsync_directory(path.parent_path());
+  }
+
+  std::optional<ChainSnapshot> read_chain_snapshot(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    constexpr size_t FIXED_BYTES = 4 + 4 + 8 + 4;
+    if (bytes.size() < FIXED_BYTES) return std::nullopt;
+
+    auto body = std::span<const uint8_t>(bytes).first(bytes.size() - sizeof(uint32_t));
+    ByteReader trailer(std::span<const uint8_t>(bytes).last(sizeof(uint32_t)));
+    if (crc32c(body) != trailer.read_u32()) return std::nullopt;
+
+    try {
+      ByteReader reader(body);
+      if (reader.read_u32() != SNAPSHOT_MAGIC) return std::nullopt;
+      const uint32_t version = reader.read_u32();
+      if (version < 1 || version > SNAPSHOT_VERSION) return std::nullopt;
+      const uint64_t count = reader.read_u64();
+      if (count > reader.remaining_bytes() / (BLOCK_HEADER_BYTES + 32)) return std::nullopt;
+      ChainSnapshot snapshot;
+      snapshot.headers.reserve(count);
+      snapshot.hashes.resize(count);
+      for (uint64_t i = 0; i < count; ++i) {
+        snapshot.headers.push_back(deserialize_header(reader.read_raw(BLOCK_HEADER_BYTES)));
+        auto hash = reader.read_raw(32);
+        std::copy(hash.begin(), hash.end(), snapshot.hashes[i].begin());
+      }
+      if (version >= 2 && reader.read_u8() != 0) {
+        snapshot.has_tx_index = true;
+        const uint64_t entries = reader.read_u64();
+        if (entries > reader.remaining_bytes() / (32 + 2)) return std::nullopt;
+        snapshot.transactions.resize(entries);
+        for (auto& entry : snapshot.transactions) {
+          auto tx_hash = reader.read_raw(32);
+          std::copy(tx_hash.begin(), tx_hash.end(), entry.tx_hash.begin());
+          entry.height = reader.read_varint();
+          const uint64_t index = reader.read_varint();
+          if (index > UINT32_MAX) return std::nullopt;
+          entry.index = static_cast<uint32_t>(index);
+        }
+      }
+      if (version >= 3 && reader.read_u8() != 0) snapshot.ledger = Ledger::read(reader);
+      if (reader.remaining_bytes() != 0) return std::nullopt;
+      return snapshot;
+    } catch (const SerializeError&) {
+      return std::nullopt;
+    }
+  }
+
+  SnapshotWriter::SnapshotWriter(fs::path path) : path_(std::move(path)) {
+    thread_ = std::thread([this] { run(); });
+  }
+
+  SnapshotWriter::~SnapshotWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stopping_ = true;
+    }
+    work_cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  void SnapshotWriter::submit(ChainSnapshot snapshot) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      pending_ = Pending{std::move(snapshot), nullptr, std::nullopt};
+    }
+    work_cv_.notify_one();
+  }
+
+  void SnapshotWriter::submit(std::shared_ptr<const ChainView> view, std::optional<Ledger> ledger) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      pending_ = Pending{std::nullopt, std::move(view), std::move(ledger)};
+    }
+    work_cv_.notify_one();
+  }
+
+  void SnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_cv_.wait(lock, [this] { return !pending_ && !in_flight_; });
+    if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+
+  uint64_t SnapshotWriter::writes() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return writes_;
+  }
+
+  void SnapshotWriter::run() {
+    ASTRO_TRACE_THREAD("snapshot-writer");
+    while (true) {
+      Pending pending;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        in_flight_ = false;
+        if (!pending_) idle_cv_.notify_all();
+        work_cv_.wait(lock, [this] { return stopping_ || pending_; });
+        // Write the last snapshot before exiting so a clean shutdown keeps it.
+        if (!pending_) return;
+        pending = std::move(*pending_);
+        pending_.reset();
+        in_flight_ = true;
+      }
+
+      std::exception_ptr error;
+      try {
+        if (!pending.snapshot) {
+          pending.snapshot = pending.view->snapshot();
+          pending.snapshot->ledger = std::move(pending.ledger);
+        }
+        write_chain_snapshot(path_, *pending.snapshot);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(mu_);
+      if (error) error_ = error;
+      else ++writes_;
+    }
+  }
+}
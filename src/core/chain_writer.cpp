@@ -0,0 +1,105 @@
+#include "astro/core/chain_writer.hpp"
+#include "astro/core/trace.hpp"
+#include <exception>
+#include <span>
+#include <vector>
+
+namespace astro::core {
+  ChainWriter::ChainWriter(Chain chain, astro::storage::BlockStorage& store, size_t max_batch)
+    : chain_(std::move(chain)), store_(store), max_batch_(max_batch == 0 ? 1 : max_batch) {
+    thread_ = std::thread([this] { run(); });
+  }
+
+  ChainWriter::~ChainWriter() {
+    stopping_.store(true);
+    wake_.fetch_add(1);
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  std::future<ValidationResult> ChainWriter::submit(Block block) {
+    Submission submission{std::move(block), {}};
+    auto future = submission.result.get_future();
+    queue_.push(std::move(submission));
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in run(): either the writer sees the block or
+    // this sees it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+      wake_.fetch_add(1, std::memory_order_release);
+      wake_.notify_one();
+    }
+    return future;
+  }
+
+  void ChainWriter::flush() {
+    const uint64_t target = submitted_.load(std::memory_order_relaxed);
+    for (uint64_t applied = applied_.load(); applied < target; applied = applied_.load()) {
+      applied_.wait(applied);
+    }
+  }
+
+  void ChainWriter::run() {
+    ASTRO_TRACE_THREAD("chain-writer");
+    std::vector<Submission> batch;
+    while (true) {
+      batch.clear();
+      while (batch.size() < max_batch_) {
+        auto submission = queue_.pop();
+        if (!submission) break;
+        batch.push_back(std::move(*submission));
+      }
+      if (!batch.empty()) {
+        apply(batch);
+        applied_.fetch_add(batch.size());
+        applied_.notify_all();
+        continue;
+      }
+
+      const uint32_t seen = wake_.load(std::memory_order_acquire);
+      sleeping_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      // Drain before exiting so a clean shutdown loses nothing.
+      if (queue_.empty()) {
+        if (stopping_.load()) return;
+        wake_.wait(seen, std::memory_order_acquire);
+      }
+      sleeping_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  // append_blocks keeps the valid prefix of what it is given, so after a
+  // rejected block the rest of the batch goes in as a new run: a competing
+  // block for the same height fails without taking its successors with it.
+  void ChainWriter::apply(std::vector<Submission>& batch) {
+    ASTRO_TRACE_SPAN("writer.apply");
+    std::vector<Block> blocks;
+    blocks.reserve(batch.size());
+    for (auto& submission : batch) blocks.push_back(std::move(submission.block));
+
+    size_t next = 0;
+    while (next < blocks.size()) {
+      BatchAppendResult result;
+      try {
+        result = chain_.append_blocks(std::span<const Block>(blocks).subspan(next), store_);
+      } catch (...) {
+        // Whatever threw, the rest of the batch fails with it and the
+        // writer carries on with the next one.
+        const auto error = std::current_exception();
+        for (; next < blocks.size(); ++next) batch[next].result.set_exception(error);
+        break;
+      }
+      if (result.appended > 0) commits_.fetch_add(1, std::memory_order_relaxed);
+      const ValidationResult ok{true, ValidationError::None, ~0ull};
+      for (size_t i = 0; i < result.appended; ++i) batch[next + i].result.set_value(ok);
+      next += result.appended;
+      if (next == blocks.size()) break;
+      if (result.validation.error == ValidationError::None) {
+        // The store write failed and nothing was appended.
+        for (; next < blocks.size(); ++next) batch[next].result.set_value(result.validation);
+        break;
+      }
+      batch[next++].result.set_value(result.validation);
+    }
+  }
+}
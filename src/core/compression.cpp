@@ -0,0 +1,186 @@
+#include "astro/storage/compression.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef ASTRO_HAVE_ZSTD
+  #include <zstd.h>
+#endif
+
+namespace astro::storage {
+  // LZ4 block format: sequences of token, literal run, 2-byte offset and match
+  // length. Lengths of 15 or more continue in 255-valued bytes. The last
+  // sequence is literals only, and per the format no match starts in the last
+  // 12 bytes or covers the last 5.
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t LAST_LITERALS = 5;
+  static constexpr size_t MATCH_LIMIT = 12;
+  static constexpr size_t MAX_OFFSET = 65535;
+  static constexpr unsigned HASH_BITS = 12;
+
+  static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  static uint32_t hash4(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  static void put_length(std::vector<uint8_t>& out, size_t length) {
+    while (length >= 255) {
+      out.push_back(255);
+      length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+  }
+
+  // `match_length` 0 marks the final, literals-only sequence.
+  static void put_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_length,
+                           size_t offset, size_t match_length) {
+    const size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15)));
+    if (literal_length >= 15) put_length(out, literal_length - 15);
+    out.insert(out.end(), literals, literals + literal_length);
+    if (match_length == 0) return;
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match_code >= 15) put_length(out, match_code - 15);
+  }
+
+  void lz4_compress(std::span<const uint8_t> in, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(in.size() + in.size() / 255 + 16);
+    const uint8_t* src = in.data();
+    const size_t n = in.size();
+    size_t anchor = 0;
+
+    if (n > MATCH_LIMIT) {
+      std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0); // position + 1, 0 = empty
+      const size_t limit = n - MATCH_LIMIT;
+      size_t pos = 0;
+      while (pos < limit) {
+        const uint32_t sequence = read32(src + pos);
+        uint32_t& slot = table[hash4(sequence)];
+        const size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+          ++pos;
+          continue;
+        }
+        const size_t ref = candidate - 1;
+        const size_t max_length = n - LAST_LITERALS - pos;
+        size_t length = MIN_MATCH;
+        while (length < max_length && src[pos + length] == src[ref + length]) ++length;
+        put_sequence(out, src + anchor, pos - anchor, pos - ref, length);
+        pos += length;
+        anchor = pos;
+      }
+    }
+    put_sequence(out, src + anchor, n - anchor, 0, 0);
+  }
+
+  void lz4_decompress(std::span<const uint8_t> in, size_t raw_size, std::vector<uint8_t>& out) {
+    auto corrupt = [] { throw std::runtime_error("lz4: corrupt input"); };
+    out.resize(raw_size);
+    size_t ip = 0, op = 0;
+    auto read_length = [&](size_t length) {
+      if (length != 15) return length;
+      uint8_t byte = 0;
+      do {
+        if (ip >= in.size()) corrupt();
+        byte = in[ip++];
+        length += byte;
+      } while (byte == 255);
+      return length;
+    };
+
+    while (true) {
+      if (ip >= in.size()) corrupt();
+      const uint8_t token = in[ip++];
+      const size_t literal_length = read_length(token >> 4);
+      if (literal_length > in.size() - ip || literal_length > raw_size - op) corrupt();
+      if (literal_length) std::memcpy(out.data() + op, in.data() + ip, literal_length);
+      ip += literal_length;
+      op += literal_length;
+      if (ip == in.size()) break;
+
+      if (in.size() - ip < 2) corrupt();
+      const size_t offset = in[ip] | (size_t(in[ip + 1]) << 8);
+      ip += 2;
+      if (offset == 0 || offset > op) corrupt();
+      const size_t match_length = read_length(token & 15) + MIN_MATCH;
+      if (match_length > raw_size - op) corrupt();
+      uint8_t* dst = out.data() + op;
+      const uint8_t* ref = dst - offset;
+      if (offset >= match_length) {
+        std::memcpy(dst, ref, match_length);
+      } else {
+        for (size_t i = 0; i < match_length; ++i) dst[i] = ref[i]; // overlapping run
+      }
+      op += match_length;
+    }
+    if (op != raw_size) corrupt();
+  }
+
+  bool compression_available(Compression codec) {
+    switch (codec) {
+      case Compression::None:
+      case Compression::Lz4:
+        return true;
+      case Compression::Zstd:
+        #ifdef ASTRO_HAVE_ZSTD
+          return true;
+        #else
+          return false;
+        #endif
+    }
+    return false;
+  }
+
+  bool compress(Compression codec, std::span<const uint8_t> in, std::vector<uint8_t>& out) {
+    switch (codec) {
+      case Compression::None:
+        return false;
+      case Compression::Lz4:
+        lz4_compress(in, out);
+        return out.size() < in.size();
+      case Compression::Zstd:
+        #ifdef ASTRO_HAVE_ZSTD
+        {
+          out.resize(ZSTD_compressBound(in.size()));
+          size_t size = ZSTD_compress(out.data(), out.size(), in.data(), in.size(), 3);
+          if (ZSTD_isError(size)) return false;
+          out.resize(size);
+          return size < in.size();
+        }
+        #else
+          return false;
+        #endif
+    }
+    return false;
+  }
+
+  void decompress(Compression codec, std::span<const uint8_t> in, size_t raw_size, std::vector<uint8_t>& out) {
+    switch (codec) {
+      case Compression::Lz4:
+        lz4_decompress(in, raw_size, out);
+        return;
+      case Compression::Zstd:
+        #ifdef ASTRO_HAVE_ZSTD
+        {
+          out.resize(raw_size);
+          size_t size = ZSTD_decompress(out.data(), out.size(), in.data(), in.size());
+          if (ZSTD_isError(size) || size != raw_size) throw std::runtime_error("zstd: corrupt input");
+          return;
+        }
+        #else
+          throw std::runtime_error("zstd: not available in this build");
+        #endif
+      case Compression::None:
+        break;
+    }
+    throw std::runtime_error("decompress: unknown codec");
+  }
+}
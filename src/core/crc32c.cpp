@@ -0,0 +1,106 @@
+#include "astro/core/crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #include <nmmintrin.h>
+  #define ASTRO_CRC32C_X86 1
+#endif
+
+namespace astro::core {
+  namespace {
+    constexpr uint32_t kPolynomial = 0x82F63B78u; // reflected Castagnoli
+
+    // Slicing-by-8 tables: table[0] is the classic byte table, table[k] advances k more bytes.
+    using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+    constexpr Tables make_tables() {
+      Tables tables{};
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ ((crc & 1u) ? kPolynomial : 0u);
+        tables[0][i] = crc;
+      }
+      for (uint32_t i = 0; i < 256; ++i) {
+        for (size_t k = 1; k < tables.size(); ++k) {
+          uint32_t prev = tables[k - 1][i];
+          tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+      }
+      return tables;
+    }
+
+    constexpr Tables kTables = make_tables();
+
+    uint64_t load_le64(const uint8_t* p) {
+      uint64_t value = 0;
+      for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(p[i]) << (8 * i);
+      return value;
+    }
+
+#ifdef ASTRO_CRC32C_X86
+    __attribute__((target("sse4.2")))
+    uint32_t crc32c_sse42(const uint8_t* data, size_t size, uint32_t crc) {
+      uint64_t crc64 = crc;
+      while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+      }
+      crc = static_cast<uint32_t>(crc64);
+      while (size > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        --size;
+      }
+      return crc;
+    }
+
+    bool detect_sse42() {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2");
+    }
+#endif
+  }
+
+  uint32_t crc32c_software(std::span<const uint8_t> data, uint32_t seed) {
+    uint32_t crc = ~seed;
+    const uint8_t* p = data.data();
+    size_t size = data.size();
+    while (size >= 8) {
+      uint64_t word = load_le64(p) ^ crc;
+      crc = kTables[7][word & 0xFF] ^
+            kTables[6][(word >> 8) & 0xFF] ^
+            kTables[5][(word >> 16) & 0xFF] ^
+            kTables[4][(word >> 24) & 0xFF] ^
+            kTables[3][(word >> 32) & 0xFF] ^
+            kTables[2][(word >> 40) & 0xFF] ^
+            kTables[1][(word >> 48) & 0xFF] ^
+            kTables[0][(word >> 56) & 0xFF];
+      p += 8;
+      size -= 8;
+    }
+    while (size > 0) {
+      crc = (crc >> 8) ^ kTables[0][(crc ^ *p++) & 0xFF];
+      --size;
+    }
+    return ~crc;
+  }
+
+  bool crc32c_hardware_available() {
+#ifdef ASTRO_CRC32C_X86
+    static const bool available = detect_sse42();
+    return available;
+#else
+    return false;
+#endif
+  }
+
+  uint32_t crc32c(std::span<const uint8_t> data, uint32_t seed) {
+#ifdef ASTRO_CRC32C_X86
+    if (crc32c_hardware_available()) return ~crc32c_sse42(data.data(), data.size(), ~seed);
+#endif
+    return crc32c_software(data, seed);
+  }
+}
@@ -0,0 +1,241 @@
+#include "astro/storage/io_uring.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#ifdef ASTRO_HAVE_IO_URING
+  #include <cerrno>
+  #include <cstring>
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace astro::storage {
+
+#ifdef ASTRO_HAVE_IO_URING
+
+  struct IoUring::Ring {
+    int fd = -1;
+    unsigned entries = 0;
+
+    void* sq_map = nullptr;
+    size_t sq_map_size = 0;
+    void* cq_map = nullptr;
+    size_t cq_map_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned pending = 0; // SQEs queued but not yet handed to the kernel
+
+    ~Ring() {
+      if (sqes) ::munmap(sqes, sqes_size);
+      if (cq_map && cq_map != sq_map) ::munmap(cq_map, cq_map_size);
+      if (sq_map) ::munmap(sq_map, sq_map_size);
+      if (fd >= 0) ::close(fd);
+    }
+
+    io_uring_sqe* next_sqe() {
+      unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+      unsigned tail = *sq_tail + pending;
+      if (tail - head >= entries) return nullptr;
+      unsigned index = tail & *sq_mask;
+      io_uring_sqe* sqe = &sqes[index];
+      std::memset(sqe, 0, sizeof(*sqe));
+      sq_array[index] = index;
+      ++pending;
+      return sqe;
+    }
+
+    void submit_and_wait(unsigned wait_for) {
+      __atomic_store_n(sq_tail, *sq_tail + pending, __ATOMIC_RELEASE);
+      unsigned to_submit = pending;
+      pending = 0;
+      while (true) {
+        long rc = ::syscall(__NR_io_uring_enter, fd, to_submit, wait_for, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (rc >= 0) return;
+        if (errno != EINTR) throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+        to_submit = 0;
+      }
+    }
+
+    template <class Fn> unsigned reap(Fn&& on_completion) {
+      unsigned head = *cq_head;
+      unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+      unsigned seen = 0;
+      for (; head != tail; ++head, ++seen) {
+        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+        on_completion(cqe.user_data, cqe.res);
+      }
+      __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+      return seen;
+    }
+  };
+
+  std::unique_ptr<IoUring> IoUring::create(unsigned entries) {
+    io_uring_params params{};
+    long fd = ::syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return nullptr;
+
+    auto ring = std::make_unique<Ring>();
+    ring->fd = static_cast<int>(fd);
+    ring->entries = params.sq_entries;
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      ring->sq_map_size = ring->cq_map_size = std::max(ring->sq_map_size, ring->cq_map_size);
+    }
+
+    void* sq_map = ::mmap(nullptr, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQ_RING);
+    if (sq_map == MAP_FAILED) return nullptr;
+    ring->sq_map = sq_map;
+    if (single_mmap) {
+      ring->cq_map = sq_map;
+    } else {
+      void* cq_map = ::mmap(nullptr, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+      if (cq_map == MAP_FAILED) return nullptr;
+      ring->cq_map = cq_map;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return nullptr;
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<uint8_t*>(ring->sq_map);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    auto* cq = static_cast<uint8_t*>(ring->cq_map);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return std::unique_ptr<IoUring>(new IoUring(std::move(ring)));
+  }
+
+  void IoUring::write_and_fsync(int fd, std::span<const uint8_t> data, uint64_t offset, bool data_only) {
+    constexpr uint64_t kWrite = 1, kFsync = 2;
+    size_t done = 0;
+    while (true) {
+      const size_t len = std::min<size_t>(data.size() - done, 1u << 30);
+      io_uring_sqe* write = ring_->next_sqe();
+      io_uring_sqe* fsync = ring_->next_sqe();
+      if (!write || !fsync) throw std::runtime_error("io_uring: submission queue full");
+
+      write->opcode = IORING_OP_WRITE;
+      write->fd = fd;
+      write->addr = reinterpret_cast<uint64_t>(data.data() + done);
+      write->len = static_cast<uint32_t>(len);
+      write->off = offset + done;
+      write->flags = IOSQE_IO_LINK; // fsync only runs if the write fully succeeds
+      write->user_data = kWrite;
+
+      fsync->opcode = IORING_OP_FSYNC;
+      fsync->fd = fd;
+      fsync->fsync_flags = data_only ? IORING_FSYNC_DATASYNC : 0;
+      fsync->user_data = kFsync;
+
+      ring_->submit_and_wait(2);
+      int write_res = 0, fsync_res = 0;
+      unsigned completed = 0;
+      while (completed < 2) {
+        completed += ring_->reap([&](uint64_t tag, int res) { (tag == kWrite ? write_res : fsync_res) = res; });
+        if (completed < 2) ring_->submit_and_wait(2 - completed);
+      }
+
+      if (write_res < 0) throw std::system_error(-write_res, std::generic_category(), "io_uring write");
+      done += static_cast<size_t>(write_res);
+      if (fsync_res == -ECANCELED && static_cast<size_t>(write_res) < len) continue; // short write
+      if (fsync_res < 0) throw std::system_error(-fsync_res, std::generic_category(), "io_uring fsync");
+      if (done >= data.size()) return;
+    }
+  }
+
+  void IoUring::read_exact(int fd, std::span<uint8_t> out, uint64_t offset, size_t chunk) {
+    struct Range { size_t pos; size_t len; };
+    std::vector<Range> ranges;
+    for (size_t pos = 0; pos < out.size(); pos += chunk) {
+      ranges.push_back({pos, std::min(chunk, out.size() - pos)});
+    }
+
+    size_t next = 0, in_flight = 0;
+    std::vector<size_t> retry;
+    int error = 0;
+    auto queue = [&](size_t index) {
+      io_uring_sqe* sqe = ring_->next_sqe();
+      if (!sqe) return false;
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = fd;
+      sqe->addr = reinterpret_cast<uint64_t>(out.data() + ranges[index].pos);
+      sqe->len = static_cast<uint32_t>(ranges[index].len);
+      sqe->off = offset + ranges[index].pos;
+      sqe->user_data = index;
+      ++in_flight;
+      return true;
+    };
+
+    // On error stop queueing but keep reaping: the kernel may still be writing into `out`.
+    while (in_flight > 0 || (error == 0 && (next < ranges.size() || !retry.empty()))) {
+      if (error == 0) {
+        while (!retry.empty() && queue(retry.back())) retry.pop_back();
+        while (next < ranges.size() && queue(next)) ++next;
+      }
+      ring_->submit_and_wait(1);
+      ring_->reap([&](uint64_t index, int res) {
+        --in_flight;
+        if (res <= 0) {
+          if (error == 0) error = res < 0 ? -res : EIO; // res == 0: file shorter than expected
+          return;
+        }
+        auto& range = ranges[index];
+        if (static_cast<size_t>(res) < range.len) {
+          range.pos += static_cast<size_t>(res);
+          range.len -= static_cast<size_t>(res);
+          retry.push_back(index);
+        }
+      });
+    }
+    if (error != 0) throw std::system_error(error, std::generic_category(), "io_uring read");
+  }
+
+  unsigned IoUring::depth() const { return ring_->entries; }
+
+#else
+
+  struct IoUring::Ring {};
+
+  std::unique_ptr<IoUring> IoUring::create(unsigned) { return nullptr; }
+
+  void IoUring::write_and_fsync(int, std::span<const uint8_t>, uint64_t, bool) {
+    throw std::logic_error("io_uring support not built");
+  }
+
+  void IoUring::read_exact(int, std::span<uint8_t>, uint64_t, size_t) {
+    throw std::logic_error("io_uring support not built");
+  }
+
+  unsigned IoUring::depth() const { return 0; }
+
+#endif
+
+  IoUring::IoUring(std::unique_ptr<Ring> ring) : ring_(std::move(ring)) {}
+  IoUring::~IoUring() = default;
+}
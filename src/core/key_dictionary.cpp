@@ -0,0 +1,135 @@
+#include "astro/storage/key_dictionary.hpp"
+#include "astro/core/crc32c.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+  #include <unistd.h>
+  #include <fcntl.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace astro::core;
+
+namespace astro::storage {
+  static std::string key_string(std::span<const uint8_t> key) {
+    return std::string(reinterpret_cast<const char*>(key.data()), key.size());
+  }
+
+  KeyDictionary::KeyDictionary(fs::path path) : path_(std::move(path)) {
+    load();
+  }
+
+  void KeyDictionary::load() {
+    if (!fs::exists(path_)) return;
+    const uint64_t file_size = fs::file_size(path_);
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) throw std::runtime_error("KeyDictionary: open failed");
+
+    uint64_t pos = 0;
+    std::vector<uint8_t> key;
+    while (file_size - pos >= 2 * sizeof(uint32_t)) {
+      uint32_t length = 0, check = 0;
+      in.read(reinterpret_cast<char*>(&length), sizeof(length));
+      if (!in || length > file_size - pos - 2 * sizeof(uint32_t)) break;
+      key.resize(length);
+      in.read(reinterpret_cast<char*>(key.data()), length);
+      in.read(reinterpret_cast<char*>(&check), sizeof(check));
+      if (!in || crc32c(key) != check) break;
+      ids_.emplace(key_string(key), keys_.size() + 1);
+      keys_.push_back(key);
+      pos += 2 * sizeof(uint32_t) + length;
+    }
+    in.close();
+
+    if (pos < file_size) {
+      fs::resize_file(path_, pos);
+      discarded_bytes_ = file_size - pos;
+    }
+  }
+
+  uint64_t KeyDictionary::intern(std::span<const uint8_t> key) {
+    if (key.empty()) return 0;
+    auto [it, inserted] = ids_.emplace(key_string(key), keys_.size() + 1);
+    if (inserted) {
+      keys_.emplace_back(key.begin(), key.end());
+      ++pending_;
+    }
+    return it->second;
+  }
+
+  void KeyDictionary::commit() {
+    if (pending_ == 0) return;
+    std::vector<uint8_t> buffer;
+    for (size_t i = keys_.size() - pending_; i < keys_.size(); ++i) {
+      const auto& key = keys_[i];
+      const uint32_t length = static_cast<uint32_t>(key.size());
+      const uint32_t check = crc32c(key);
+      const auto* l = reinterpret_cast<const uint8_t*>(&length);
+      const auto* c = reinterpret_cast<const uint8_t*>(&check);
+      buffer.insert(buffer.end(), l, l + sizeof(length));
+      buffer.insert(buffer.end(), key.begin(), key.end());
+      buffer.insert(buffer.end(), c, c + sizeof(check));
+    }
+
+    const uint64_t old_size = fs::exists(path_) ? fs::file_size(path_) : 0;
+    try {
+      #ifndef _WIN32
+        int fd = ::open(path_.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "KeyDictionary: open failed");
+        auto fail = [fd](const char* what) {
+          int err = errno;
+          ::close(fd);
+          throw std::system_error(err, std::generic_category(), what);
+        };
+        size_t done = 0;
+        while (done < buffer.size()) {
+          ssize_t n = ::write(fd, buffer.data() + done, buffer.size() - done);
+          if (n < 0) {
+            if (errno == EINTR) continue;
+            fail("KeyDictionary: write failed");
+          }
+          done += static_cast<size_t>(n);
+        }
+        if (::fsync(fd) != 0) fail("KeyDictionary: fsync failed");
+        ::close(fd);
+      #else
+        std::ofstream out(path_, std::ios::binary | std::ios::app);
+        out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        out.flush();
+        if (!out.good()) throw std::runtime_error("KeyDictionary: write failed");
+      #endif
+    } catch (...) {
+      std::error_code ec;
+      fs::resize_file(path_, old_size, ec);
+      discard_pending();
+      throw;
+    }
+    pending_ = 0;
+  }
+
+  void KeyDictionary::discard_pending() {
+    for (; pending_ > 0; --pending_) {
+      ids_.erase(key_string(keys_.back()));
+      keys_.pop_back();
+    }
+  }
+
+  const std::vector<uint8_t>& KeyDictionary::at(uint64_t id) const {
+    static const std::vector<uint8_t> empty;
+    if (id == 0) return empty;
+    if (id > keys_.size()) throw std::runtime_error("KeyDictionary: unknown key id");
+    return keys_[id - 1];
+  }
+
+  void KeyDictionary::clear() {
+    std::error_code ec;
+    fs::remove(path_, ec);
+    keys_.clear();
+    ids_.clear();
+    pending_ = 0;
+    discarded_bytes_ = 0;
+  }
+}
@@ -0,0 +1,126 @@
+#include "astro/core/ledger.hpp"
+#include <algorithm>
+
+namespace astro::core {
+  const Ledger::Sender* Ledger::sender(const Hash160& key_hash) const {
+    auto it = senders_.find(key_hash);
+    return it == senders_.end() ? nullptr : &it->second;
+  }
+
+  uint64_t Ledger::received(const std::string& label) const {
+    auto it = received_.find(label);
+    return it == received_.end() ? 0 : it->second;
+  }
+
+  bool Ledger::check(const Block& block, size_t* bad_tx) const {
+    std::vector<std::optional<Hash160>> keys;
+    return check(block, keys, bad_tx);
+  }
+
+  bool Ledger::NonceCheck::next(const Hash160& key, uint64_t nonce) {
+    auto in_block = std::find_if(seen_.begin(), seen_.end(), [&](const auto& entry) { return entry.first == key; });
+    std::optional<uint64_t> last;
+    if (in_block != seen_.end()) {
+      last = in_block->second;
+    } else if (auto it = ledger_.senders_.find(key); it != ledger_.senders_.end() && it->second.tx_count > 0) {
+      last = it->second.last_nonce;
+    }
+    if (last && nonce <= *last) return false;
+    if (in_block != seen_.end()) in_block->second = nonce;
+    else seen_.emplace_back(key, nonce);
+    return true;
+  }
+
+  bool Ledger::check(const Block& block, std::vector<std::optional<Hash160>>& keys, size_t* bad_tx) const {
+    keys.clear();
+    keys.reserve(block.transactions.size());
+    NonceCheck nonces(*this);
+    for (size_t i = 0; i < block.transactions.size(); ++i) {
+      const auto& tx = block.transactions[i];
+      if (tx.from_pub_pem.empty()) {  // genesis coinbase
+        keys.emplace_back();
+        continue;
+      }
+      const Hash160 key = hash160(tx.from_pub_pem);
+      keys.emplace_back(key);
+      if (!nonces.next(key, tx.nonce)) {
+        if (bad_tx) *bad_tx = i;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Ledger::apply(const Block& block, Undo* undo, size_t* bad_tx) {
+    std::vector<std::optional<Hash160>> keys;
+    if (!check(block, keys, bad_tx)) return false;
+    for (size_t i = 0; i < block.transactions.size(); ++i) {
+      const auto& tx = block.transactions[i];
+      if (keys[i]) {
+        auto [it, inserted] = senders_.try_emplace(*keys[i]);
+        if (undo) undo->senders.emplace_back(*keys[i], inserted ? std::nullopt : std::optional<Sender>(it->second));
+        it->second.sent += tx.amount;
+        it->second.last_nonce = tx.nonce;
+        ++it->second.tx_count;
+      }
+      auto [it, inserted] = received_.try_emplace(tx.to_label, 0);
+      if (undo) undo->recipients.emplace_back(tx.to_label, inserted ? std::nullopt : std::optional<uint64_t>(it->second));
+      it->second += tx.amount;
+    }
+    return true;
+  }
+
+  void Ledger::undo(const Undo& undo) {
+    for (auto it = undo.senders.rbegin(); it != undo.senders.rend(); ++it) {
+      if (it->second) senders_[it->first] = *it->second;
+      else senders_.erase(it->first);
+    }
+    for (auto it = undo.recipients.rbegin(); it != undo.recipients.rend(); ++it) {
+      if (it->second) received_[it->first] = *it->second;
+      else received_.erase(it->first);
+    }
+  }
+
+  // u64 sender count, then per sender the key hash and varint sent,
+  // last_nonce and tx_count; u64 recipient count, then per recipient the
+  // label and varint amount received.
+  void Ledger::write(ByteWriter& writer) const {
+    writer.write_u64(senders_.size());
+    for (const auto& [key, sender] : senders_) {
+      writer.write_raw(key);
+      writer.write_varint(sender.sent);
+      writer.write_varint(sender.last_nonce);
+      writer.write_varint(sender.tx_count);
+    }
+    writer.write_u64(received_.size());
+    for (const auto& [label, amount] : received_) {
+      writer.write_string(label);
+      writer.write_varint(amount);
+    }
+  }
+
+  Ledger Ledger::read(ByteReader& reader) {
+    Ledger ledger;
+    const uint64_t senders = reader.read_u64();
+    if (senders > reader.remaining_bytes() / (20 + 3)) throw SerializeError("Ledger: sender count out of range");
+    ledger.senders_.reserve(senders);
+    for (uint64_t i = 0; i < senders; ++i) {
+      Hash160 key;
+      auto bytes = reader.read_raw(key.size());
+      std::copy(bytes.begin(), bytes.end(), key.begin());
+      Sender sender;
+      sender.sent = reader.read_varint();
+      sender.last_nonce = reader.read_varint();
+      sender.tx_count = reader.read_varint();
+      ledger.senders_[key] = sender;
+    }
+    const uint64_t recipients = reader.read_u64();
+    if (recipients > reader.remaining_bytes() / (4 + 1)) throw SerializeError("Ledger: recipient count out of range");
+    ledger.received_.reserve(recipients);
+    for (uint64_t i = 0; i < recipients; ++i) {
+      auto label = reader.read_string();
+      ledger.received_[std::move(label)] = reader.read_varint();
+    }
+    return ledger;
+  }
+}
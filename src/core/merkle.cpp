@@ -2,6 +2,7 @@
 #include "astro/core/hash.hpp"
 #include <cassert>
 #include <cstring>
+#include <optional>
 
 namespace astro::core {
 
@@ -41,6 +42,38 @@ namespace astro::core {
     return level_hashes.front();
   }
 
+  static Hash256 hash_pair(const Hash256& left, const Hash256& right) {
+    return hash_pair(std::span<const uint8_t>(left.data(), left.size()),
+                     std::span<const uint8_t>(right.data(), right.size()));
+  }
+
+  void MerkleAccumulator::add(const Hash256& leaf) {
+    Hash256 node = leaf;
+    size_t level = 0;
+    for (; (count_ >> level) & 1; ++level) node = hash_pair(frontier_[level], node);
+    frontier_[level] = node;
+    ++count_;
+  }
+
+  // Folds the frontier from the bottom. A level's odd last node is paired
+  // with itself, as root() does, unless it is the only node left.
+  Hash256 MerkleAccumulator::root() const {
+    if (count_ == 0) return empty_root();
+    if (count_ == 1) return hash_pair(frontier_[0], frontier_[0]);
+    std::optional<Hash256> carry;
+    for (size_t level = 0; (count_ >> level) != 0; ++level) {
+      const bool pending = (count_ >> level) & 1;
+      const bool above = (count_ >> (level + 1)) != 0;
+      if (carry) {
+        carry = pending ? hash_pair(frontier_[level], *carry) : hash_pair(*carry, *carry);
+      } else if (pending) {
+        if (!above) return frontier_[level];
+        carry = hash_pair(frontier_[level], frontier_[level]);
+      }
+    }
+    return *carry;
+  }
+
   MerkleProof build_proof(const std::vector<Hash256>& leaves, size_t index) {
     MerkleProof proof{};
     if (leaves.empty()) return proof;
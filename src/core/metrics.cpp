@@ -0,0 +1,178 @@
+#include "astro/core/metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <vector>
+
+namespace astro::core::metrics {
+  const char* name(Timer timer) {
+    switch (timer) {
+      case Timer::ValidateHeader: return "validate.header";
+      case Timer::ValidateStructure: return "validate.structure";
+      case Timer::ValidateSignatures: return "validate.signatures";
+      case Timer::StoreSerialize: return "store.serialize";
+      case Timer::StoreWrite: return "store.write";
+      case Timer::StoreFsync: return "store.fsync";
+      case Timer::StoreLoad: return "store.load";
+    }
+    return "unknown";
+  }
+
+  const char* name(Counter counter) {
+    switch (counter) {
+      case Counter::StoreBlocksAppended: return "store.blocks_appended";
+      case Counter::StoreBytesAppended: return "store.bytes_appended";
+      case Counter::StoreBlocksLoaded: return "store.blocks_loaded";
+      case Counter::StorePruneFailures: return "store.prune_failures";
+      case Counter::BlocksAccepted: return "chain.blocks_accepted";
+      case Counter::TransactionsAccepted: return "chain.transactions_accepted";
+      case Counter::BodyCacheHits: return "chain.body_cache_hits";
+      case Counter::BodyCacheMisses: return "chain.body_cache_misses";
+      case Counter::MineHashes: return "mine.hashes";
+    }
+    return "unknown";
+  }
+
+  size_t Histogram::bucket_of(uint64_t nanos) {
+    if (nanos == 0) return 0;
+    return std::min<size_t>(std::bit_width(nanos) - 1, BUCKETS - 1);
+  }
+
+  uint64_t Histogram::quantile_nanos(double q) const {
+    if (count == 0) return 0;
+    const auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+      seen += buckets[b];
+      if (seen > rank) return bucket_upper_nanos(b);
+    }
+    return bucket_upper_nanos(BUCKETS - 1);
+  }
+
+#ifdef ASTRO_METRICS
+  namespace {
+    // Written only by the owning thread, so a plain load and store stand in
+    // for fetch_add; other threads read them relaxed.
+    struct Cell {
+      std::atomic<uint64_t> value{0};
+      void bump(uint64_t by) { value.store(value.load(std::memory_order_relaxed) + by, std::memory_order_relaxed); }
+      uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    };
+
+    struct TimerCells {
+      Cell count;
+      Cell total_nanos;
+      std::array<Cell, BUCKETS> buckets;
+    };
+
+    struct ThreadCells {
+      uint32_t id = 0;
+      std::array<TimerCells, TIMER_COUNT> timers;
+      std::array<Cell, COUNTER_COUNT> counters;
+    };
+
+    void add_into(Snapshot& out, const ThreadCells& cells) {
+      for (size_t t = 0; t < TIMER_COUNT; ++t) {
+        auto& histogram = out.timers[t];
+        histogram.count += cells.timers[t].count.get();
+        histogram.total_nanos += cells.timers[t].total_nanos.get();
+        for (size_t b = 0; b < BUCKETS; ++b) histogram.buckets[b] += cells.timers[t].buckets[b].get();
+      }
+      for (size_t c = 0; c < COUNTER_COUNT; ++c) out.counters[c] += cells.counters[c].get();
+    }
+
+    void subtract(Snapshot& from, const Snapshot& base) {
+      for (size_t t = 0; t < TIMER_COUNT; ++t) {
+        from.timers[t].count -= base.timers[t].count;
+        from.timers[t].total_nanos -= base.timers[t].total_nanos;
+        for (size_t b = 0; b < BUCKETS; ++b) from.timers[t].buckets[b] -= base.timers[t].buckets[b];
+      }
+      for (size_t c = 0; c < COUNTER_COUNT; ++c) from.counters[c] -= base.counters[c];
+    }
+
+    // Live threads' cells, plus what exited threads left behind. reset()
+    // moves the baseline rather than zeroing cells it doesn't own.
+    struct Registry {
+      std::mutex mutex;
+      std::vector<const ThreadCells*> live;
+      uint32_t next_id = 1;
+      Snapshot retired;
+      Snapshot baseline;
+
+      Snapshot totals() {
+        Snapshot out = retired;
+        for (const auto* cells : live) add_into(out, *cells);
+        return out;
+      }
+    };
+
+    // Never destroyed: threads may still exit after static destructors run.
+    Registry& registry() {
+      static auto* instance = new Registry;
+      return *instance;
+    }
+
+    struct ThreadSlot {
+      ThreadCells cells;
+      ThreadSlot() {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        cells.id = r.next_id++;
+        r.live.push_back(&cells);
+      }
+      ~ThreadSlot() {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        add_into(r.retired, cells);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &cells));
+      }
+    };
+
+    ThreadCells& local() {
+      thread_local ThreadSlot slot;
+      return slot.cells;
+    }
+  }
+
+  void record(Timer timer, uint64_t nanos) {
+    auto& cells = local().timers[static_cast<size_t>(timer)];
+    cells.count.bump(1);
+    cells.total_nanos.bump(nanos);
+    cells.buckets[Histogram::bucket_of(nanos)].bump(1);
+  }
+
+  void add(Counter counter, uint64_t value) {
+    local().counters[static_cast<size_t>(counter)].bump(value);
+  }
+
+  Snapshot snapshot() {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    Snapshot out = r.totals();
+    subtract(out, r.baseline);
+    return out;
+  }
+
+  void reset() {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.baseline = r.totals();
+  }
+
+  std::vector<std::pair<uint32_t, uint64_t>> per_thread(Counter counter) {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    std::vector<std::pair<uint32_t, uint64_t>> out;
+    for (const auto* cells : r.live) {
+      if (uint64_t value = cells->counters[static_cast<size_t>(counter)].get()) out.emplace_back(cells->id, value);
+    }
+    if (uint64_t value = r.retired.counters[static_cast<size_t>(counter)]) out.emplace_back(0, value);
+    return out;
+  }
+#else
+  Snapshot snapshot() { return {}; }
+  void reset() {}
+  std::vector<std::pair<uint32_t, uint64_t>> per_thread(Counter) { return {}; }
+#endif
+}
@@ -1,9 +1,12 @@
 #include "astro/core/miner.hpp"
 #include "astro/core/pow.hpp"
 #include "astro/core/hash.hpp"
+#include "astro/core/metrics.hpp"
+#include "astro/core/trace.hpp"
 #include <span>
 #include <chrono>
 #include <cstdint>
+#include <optional>
 
 
 namespace astro::core {
@@ -11,25 +14,48 @@ namespace astro::core {
   Block mine_block(const Chain& chain, std::vector<Transaction> transactions, 
                   uint32_t difficulty_bits, std::atomic<bool>& cancel_flag,
                   MinerProgressCallback on_progress, uint64_t tick_every_ms) {
+    return mine_block(*chain.view(), std::move(transactions), difficulty_bits, cancel_flag,
+                      std::move(on_progress), tick_every_ms);
+  }
+
+  Block mine_block(const ChainView& view, std::vector<Transaction> transactions,
+                  uint32_t difficulty_bits, std::atomic<bool>& cancel_flag,
+                  MinerProgressCallback on_progress, uint64_t tick_every_ms) {
         
     uint64_t now = static_cast<uint64_t>(
       std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count()
     );
-    Block block = chain.build_block_from_transactions(std::move(transactions), now); 
+    Block block = view.build_block_from_transactions(std::move(transactions), now); 
 
     uint64_t attempts = 0;
     uint64_t last_transaction_bump = 0;
+    // Hashes are counted and traced a round of MINE_ROUND nonces at a time;
+    // the clock is only read between rounds.
+    constexpr uint64_t MINE_ROUND = 1 << 16;
+    auto round_begins = [] { return trace::active() ? std::optional(trace::now_ns()) : std::nullopt; };
+    std::optional<uint64_t> round_start = round_begins();
+    auto end_round = [&] {
+      if (round_start) trace::record("mine.round", *round_start, trace::now_ns());
+      round_start = round_begins();
+    };
 
-    for (uint64_t nonce = 0; !cancel_flag; ++nonce) {
+    uint64_t nonce = 0;
+    for (; !cancel_flag; ++nonce) {
       block.header.nonce = nonce;
       auto hash = block.header.hash();
       auto leading_zeros = pow::leading_zero_bits(hash);
 
       if (leading_zeros >= difficulty_bits) {
         // Found a valid block
+        ASTRO_METRICS_ADD(metrics::Counter::MineHashes, nonce % MINE_ROUND + 1);
+        end_round();
         return block;
       }
+      if (nonce % MINE_ROUND == MINE_ROUND - 1) {
+        ASTRO_METRICS_ADD(metrics::Counter::MineHashes, MINE_ROUND);
+        end_round();
+      }
 
       if (on_progress && (++attempts % tick_every_ms == 0)) {
         on_progress(attempts, leading_zeros, to_hex(std::span<const uint8_t>(hash.data(), hash.size())));
@@ -48,6 +74,8 @@ namespace astro::core {
       }
     }
 
+    ASTRO_METRICS_ADD(metrics::Counter::MineHashes, nonce % MINE_ROUND);
+    end_round();
     throw std::runtime_error("Mining cancelled");
   }
 }
\ No newline at end of file
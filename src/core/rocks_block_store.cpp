@@ -0,0 +1,171 @@
+#ifdef ASTRO_HAVE_ROCKSDB
+#include "astro/storage/rocks_block_store.hpp"
+#include <stdexcept>
+#include <string>
+
+#include <rocksdb/db.h>
+#include <rocksdb/iterator.h>
+#include <rocksdb/options.h>
+#include <rocksdb/write_batch.h>
+
+namespace fs = std::filesystem;
+using namespace astro::core;
+
+namespace astro::storage {
+  namespace {
+    enum ColumnFamily : size_t { kDefault = 0, kBlocks, kHashIndex, kTxIndex };
+
+    // Big-endian so RocksDB's bytewise ordering is height ordering.
+    std::string height_key(uint64_t height) {
+      std::string key(8, '\0');
+      for (int i = 7; i >= 0; --i) { key[i] = static_cast<char>(height & 0xFF); height >>= 8; }
+      return key;
+    }
+
+    uint64_t decode_height(const rocksdb::Slice& key) {
+      uint64_t height = 0;
+      for (size_t i = 0; i < 8 && i < key.size(); ++i) height = (height << 8) | static_cast<uint8_t>(key[i]);
+      return height;
+    }
+
+    rocksdb::Slice hash_slice(const Hash256& hash) {
+      return rocksdb::Slice(reinterpret_cast<const char*>(hash.data()), hash.size());
+    }
+
+    void check(const rocksdb::Status& status, const char* what) {
+      if (!status.ok()) throw std::runtime_error(std::string("RocksBlockStore: ") + what + ": " + status.ToString());
+    }
+  }
+
+  struct RocksBlockStore::Impl {
+    rocksdb::DB* db = nullptr;
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+
+    ~Impl() {
+      for (auto* handle : handles) db->DestroyColumnFamilyHandle(handle);
+      delete db;
+    }
+  };
+
+  RocksBlockStore::RocksBlockStore(fs::path root_path) : root_path_(std::move(root_path)) {
+    if (!fs::exists(root_path_)) fs::create_directories(root_path_);
+
+    rocksdb::DBOptions db_options;
+    db_options.create_if_missing = true;
+    db_options.create_missing_column_families = true;
+
+    rocksdb::ColumnFamilyOptions cf_options;
+    std::vector<rocksdb::ColumnFamilyDescriptor> families = {
+      {rocksdb::kDefaultColumnFamilyName, cf_options},
+      {"blocks", cf_options},
+      {"hash_index", cf_options},
+      {"tx_index", cf_options},
+    };
+
+    auto impl = std::make_unique<Impl>();
+    check(rocksdb::DB::Open(db_options, (root_path_ / "rocks").string(), families, &impl->handles, &impl->db),
+          "open");
+    impl_ = std::move(impl);
+
+    std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(rocksdb::ReadOptions(), impl_->handles[kBlocks]));
+    it->SeekToLast();
+    if (it->Valid()) count_ = decode_height(it->key()) + 1;
+    check(it->status(), "scan tip");
+  }
+
+  RocksBlockStore::~RocksBlockStore() = default;
+
+  void RocksBlockStore::append_block(const Block& block) {
+    append_blocks(std::span<const Block>(&block, 1));
+  }
+
+  void RocksBlockStore::append_blocks(std::span<const Block> blocks) {
+    if (blocks.empty()) return;
+    rocksdb::WriteBatch batch;
+    uint64_t height = count_;
+    for (const auto& block : blocks) {
+      const auto key = height_key(height);
+      const auto payload = block.serialize();
+      const auto header_hash = block.header.hash();
+      check(batch.Put(impl_->handles[kBlocks], key,
+                      rocksdb::Slice(reinterpret_cast<const char*>(payload.data()), payload.size())),
+            "batch put block");
+      check(batch.Put(impl_->handles[kHashIndex], hash_slice(header_hash), key), "batch put hash");
+      for (size_t i = 0; i < block.transactions.size(); ++i) {
+        std::string location = key;
+        for (int shift = 24; shift >= 0; shift -= 8) location.push_back(static_cast<char>((i >> shift) & 0xFF));
+        check(batch.Put(impl_->handles[kTxIndex], hash_slice(block.transactions[i].tx_hash()), location),
+              "batch put tx");
+      }
+      ++height;
+    }
+    rocksdb::WriteOptions write_options;
+    write_options.sync = true;
+    check(impl_->db->Write(write_options, &batch), "write");
+    count_ = height;
+  }
+
+  std::vector<Block> RocksBlockStore::load_all_blocks() {
+    std::vector<Block> out;
+    out.reserve(count_);
+    rocksdb::ReadOptions read_options;
+    read_options.fill_cache = false;
+    read_options.readahead_size = 4 << 20;
+    std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(read_options, impl_->handles[kBlocks]));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      auto value = it->value();
+      out.push_back(deserialize_block(
+        std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(value.data()), value.size())));
+    }
+    check(it->status(), "load");
+    return out;
+  }
+
+  void RocksBlockStore::clear() {
+    // Everything sorts before 33 bytes of 0xFF: 8-byte heights and 32-byte hashes.
+    const std::string end(33, '\xff');
+    rocksdb::WriteBatch batch;
+    for (size_t cf : {kBlocks, kHashIndex, kTxIndex}) {
+      check(batch.DeleteRange(impl_->handles[cf], rocksdb::Slice(), end), "batch clear");
+    }
+    rocksdb::WriteOptions write_options;
+    write_options.sync = true;
+    check(impl_->db->Write(write_options, &batch), "clear");
+    count_ = 0;
+  }
+
+  std::optional<Block> RocksBlockStore::read_block(uint64_t height) const {
+    std::string value;
+    auto status = impl_->db->Get(rocksdb::ReadOptions(), impl_->handles[kBlocks], height_key(height), &value);
+    if (status.IsNotFound()) return std::nullopt;
+    check(status, "read block");
+    return deserialize_block(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+  }
+
+  std::vector<Transaction> RocksBlockStore::read_body(uint64_t height) {
+    auto block = read_block(height);
+    if (!block) throw std::out_of_range("RocksBlockStore: no block at that height");
+    return std::move(block->transactions);
+  }
+
+  std::optional<uint64_t> RocksBlockStore::height_of(const Hash256& header_hash) const {
+    std::string value;
+    auto status = impl_->db->Get(rocksdb::ReadOptions(), impl_->handles[kHashIndex], hash_slice(header_hash), &value);
+    if (status.IsNotFound()) return std::nullopt;
+    check(status, "hash lookup");
+    return decode_height(value);
+  }
+
+  std::optional<TxLocation> RocksBlockStore::find_transaction(const Hash256& tx_hash) const {
+    std::string value;
+    auto status = impl_->db->Get(rocksdb::ReadOptions(), impl_->handles[kTxIndex], hash_slice(tx_hash), &value);
+    if (status.IsNotFound()) return std::nullopt;
+    check(status, "tx lookup");
+    if (value.size() != 12) throw std::runtime_error("RocksBlockStore: bad tx index entry");
+    TxLocation location;
+    location.height = decode_height(value);
+    for (size_t i = 8; i < 12; ++i) location.index = (location.index << 8) | static_cast<uint8_t>(value[i]);
+    return location;
+  }
+}
+#endif
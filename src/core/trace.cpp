@@ -0,0 +1,208 @@
+#include "astro/core/trace.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace astro::core::trace {
+  uint64_t now_ns() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+  }
+
+#ifdef ASTRO_TRACE
+  namespace {
+    // Fields are atomics so the dump may read a slot while its thread
+    // overwrites it; the ring's counters tell it which reads to keep.
+    struct Slot {
+      std::atomic<const char*> name{nullptr};
+      std::atomic<uint64_t> start{0};
+      std::atomic<uint64_t> end{0};
+    };
+
+    struct Ring {
+      explicit Ring(uint32_t id) : tid(id) {}
+
+      const uint32_t tid;
+      std::atomic<const char*> thread_name{nullptr};
+      std::atomic<bool> exited{false};
+      // Spans whose slot the owner has started writing. Bumped before the
+      // slot, so a reader that saw any part of span n also sees n + 1 here.
+      std::atomic<uint64_t> claimed{0};
+      // Spans written in full.
+      std::atomic<uint64_t> written{0};
+      std::array<Slot, CAPACITY> slots;
+    };
+
+    struct Registry {
+      std::mutex mutex;
+      std::vector<std::shared_ptr<Ring>> rings;
+      uint32_t next_tid = 1;
+      std::atomic<bool> active{false};
+      std::atomic<uint64_t> session_start{0};
+      std::string exit_path;
+    };
+
+    // Never destroyed: threads may still exit after static destructors run.
+    Registry& registry() {
+      static auto* instance = new Registry;
+      return *instance;
+    }
+
+    thread_local const char* t_thread_name = nullptr;
+
+    // Allocated on the thread's first span, so threads that never record
+    // while tracing cost nothing.
+    struct LocalRing {
+      std::shared_ptr<Ring> ring;
+      ~LocalRing() {
+        if (ring) ring->exited.store(true, std::memory_order_release);
+      }
+      Ring& get() {
+        if (!ring) {
+          auto& r = registry();
+          std::lock_guard lock(r.mutex);
+          ring = std::make_shared<Ring>(r.next_tid++);
+          ring->thread_name.store(t_thread_name, std::memory_order_relaxed);
+          r.rings.push_back(ring);
+        }
+        return *ring;
+      }
+    };
+    thread_local LocalRing t_ring;
+
+    void write_escaped(std::ostream& out, const char* text) {
+      for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        if (static_cast<unsigned char>(*c) >= 0x20) out << *c;
+      }
+    }
+
+    void write_exit_trace() {
+      write_json_file(registry().exit_path);
+    }
+  }
+
+  void start() {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    std::erase_if(r.rings, [](const auto& ring) { return ring->exited.load(std::memory_order_acquire); });
+    r.session_start.store(now_ns(), std::memory_order_relaxed);
+    r.active.store(true, std::memory_order_relaxed);
+  }
+
+  void stop() { registry().active.store(false, std::memory_order_relaxed); }
+
+  bool active() { return registry().active.load(std::memory_order_relaxed); }
+
+  bool start_from_env() {
+    const char* path = std::getenv("ASTRO_TRACE");
+    if (!path || !*path) return false;
+    registry().exit_path = path;
+    start();
+    std::atexit(write_exit_trace);
+    return true;
+  }
+
+  void set_thread_name(const char* name) {
+    t_thread_name = name;
+    if (t_ring.ring) t_ring.ring->thread_name.store(name, std::memory_order_relaxed);
+  }
+
+  void record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    if (!active()) return;
+    auto& ring = t_ring.get();
+    const uint64_t n = ring.claimed.load(std::memory_order_relaxed);
+    ring.claimed.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    auto& slot = ring.slots[n % CAPACITY];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start_ns, std::memory_order_relaxed);
+    slot.end.store(end_ns, std::memory_order_relaxed);
+    ring.written.store(n + 1, std::memory_order_release);
+  }
+
+  // Timestamps in microseconds, as the format expects; the ring's own
+  // thread may still be appending, so only its settled spans are written.
+  void write_json(std::ostream& out) {
+    auto& r = registry();
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+      std::lock_guard lock(r.mutex);
+      rings = r.rings;
+    }
+    const uint64_t since = r.session_start.load(std::memory_order_relaxed);
+    struct Span {
+      const char* name;
+      uint64_t start;
+      uint64_t end;
+    };
+
+    char number[64];
+    auto micros = [&](uint64_t ns) {
+      std::snprintf(number, sizeof(number), "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+      return number;
+    };
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto next = [&] {
+      if (!first) out << ',';
+      first = false;
+      out << "\n";
+    };
+    std::vector<Span> spans;
+    for (const auto& ring : rings) {
+      if (const char* name = ring->thread_name.load(std::memory_order_relaxed)) {
+        next();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":\"";
+        write_escaped(out, name);
+        out << "\"}}";
+      }
+      const uint64_t written = ring->written.load(std::memory_order_acquire);
+      const uint64_t first_kept = written > CAPACITY ? written - CAPACITY : 0;
+      spans.clear();
+      for (uint64_t n = first_kept; n < written; ++n) {
+        const auto& slot = ring->slots[n % CAPACITY];
+        spans.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                         slot.end.load(std::memory_order_relaxed)});
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Slots the owner has since claimed again may mix two spans.
+      const uint64_t reclaimed = ring->claimed.load(std::memory_order_relaxed);
+      for (uint64_t n = first_kept; n < written; ++n) {
+        const auto& span = spans[n - first_kept];
+        if (n + CAPACITY < reclaimed || !span.name || span.start < since || span.end < span.start) continue;
+        next();
+        out << "{\"name\":\"";
+        write_escaped(out, span.name);
+        out << "\",\"cat\":\"astro\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid;
+        out << ",\"ts\":" << micros(span.start);
+        out << ",\"dur\":" << micros(span.end - span.start) << '}';
+      }
+    }
+    out << "\n]}\n";
+  }
+#else
+  void start() {}
+  void stop() {}
+  bool active() { return false; }
+  bool start_from_env() { return false; }
+  void set_thread_name(const char*) {}
+  void record(const char*, uint64_t, uint64_t) {}
+  void write_json(std::ostream& out) { out << "{\"traceEvents\":[]}\n"; }
+#endif
+
+  bool write_json_file(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    write_json(out);
+    return static_cast<bool>(out);
+  }
+}
@@ -42,4 +42,19 @@ namespace astro::core {
     auto message = serialize(true);
     return verify_message(from_pub_pem, std::span<const uint8_t>(message.data(), message.size()), std::span<const uint8_t>(signature.data(), signature.size()));
   }
+
+  Transaction deserialize_transaction(std::span<const uint8_t> bytes) {
+    ByteReader reader(bytes);
+    (void)reader.read_u8(); // 0xA1
+    (void)reader.read_u8(); // 0x01
+    (void)reader.read_u32(); // reserved/schema
+    Transaction tx;
+    tx.version = reader.read_u32();
+    tx.nonce = reader.read_u64();
+    tx.amount = reader.read_u64();
+    tx.from_pub_pem = reader.read_bytes();
+    tx.to_label = reader.read_string();
+    tx.signature = reader.read_bytes();
+    return tx;
+  }
 }
\ No newline at end of file
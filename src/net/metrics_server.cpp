@@ -0,0 +1,201 @@
+#include "astro/net/metrics_server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <string_view>
+#include <system_error>
+#include "astro/core/metrics.hpp"
+#include "astro/core/trace.hpp"
+
+#ifndef _WIN32
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <poll.h>
+  #include <sys/socket.h>
+  #include <sys/time.h>
+  #include <unistd.h>
+#endif
+
+namespace astro::net {
+  namespace metrics = astro::core::metrics;
+
+  // "validate.header" -> "astro_validate_header"
+  static std::string metric_name(const char* dotted) {
+    std::string name = "astro_";
+    for (const char* c = dotted; *c; ++c) name += *c == '.' ? '_' : *c;
+    return name;
+  }
+
+  static void append_line(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    const int n = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n > 0) out.append(line, std::min<size_t>(static_cast<size_t>(n), sizeof(line) - 1));
+  }
+
+  std::string render_metrics(const astro::core::ChainView* view, uint64_t now_unix) {
+    std::string out;
+    if (view) {
+      out += "# HELP astro_chain_height Blocks in the chain.\n# TYPE astro_chain_height gauge\n";
+      append_line(out, "astro_chain_height %zu\n", view->height());
+      if (const auto* tip = view->tip_header()) {
+        out += "# HELP astro_chain_tip_timestamp_seconds Timestamp of the tip block.\n"
+               "# TYPE astro_chain_tip_timestamp_seconds gauge\n";
+        append_line(out, "astro_chain_tip_timestamp_seconds %" PRIu64 "\n", tip->timestamp);
+        out += "# HELP astro_chain_tip_age_seconds Seconds since the tip block's timestamp.\n"
+               "# TYPE astro_chain_tip_age_seconds gauge\n";
+        append_line(out, "astro_chain_tip_age_seconds %" PRId64 "\n",
+                    static_cast<int64_t>(now_unix) - static_cast<int64_t>(tip->timestamp));
+      }
+    }
+
+    const auto snapshot = metrics::snapshot();
+    for (size_t t = 0; t < metrics::TIMER_COUNT; ++t) {
+      const auto timer = static_cast<metrics::Timer>(t);
+      const auto& histogram = snapshot[timer];
+      const auto name = metric_name(metrics::name(timer)) + "_seconds";
+      append_line(out, "# HELP %s Time spent in %s.\n# TYPE %s histogram\n", name.c_str(), metrics::name(timer),
+                  name.c_str());
+      // The last bucket has no upper bound, so it only shows in +Inf.
+      uint64_t cumulative = 0;
+      for (size_t b = 0; b + 1 < metrics::BUCKETS; ++b) {
+        cumulative += histogram.buckets[b];
+        append_line(out, "%s_bucket{le=\"%.9g\"} %" PRIu64 "\n", name.c_str(),
+                    metrics::Histogram::bucket_upper_nanos(b) / 1e9, cumulative);
+      }
+      // Buckets are bumped after the count, so a scrape mid-record can see
+      // one more in them.
+      const uint64_t count = std::max(histogram.count, cumulative + histogram.buckets[metrics::BUCKETS - 1]);
+      append_line(out, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name.c_str(), count);
+      append_line(out, "%s_sum %.9f\n", name.c_str(), histogram.total_nanos / 1e9);
+      append_line(out, "%s_count %" PRIu64 "\n", name.c_str(), count);
+    }
+
+    for (size_t c = 0; c < metrics::COUNTER_COUNT; ++c) {
+      const auto counter = static_cast<metrics::Counter>(c);
+      const auto name = metric_name(metrics::name(counter)) + "_total";
+      append_line(out, "# HELP %s Count of %s.\n# TYPE %s counter\n", name.c_str(), metrics::name(counter),
+                  name.c_str());
+      if (counter == metrics::Counter::MineHashes) {
+        // Per mining thread, so the dashboard can show each one's rate.
+        // Threads that have exited are summed under thread="exited", so
+        // the series together never go down.
+        for (const auto& [thread, value] : metrics::per_thread(counter)) {
+          if (thread == 0) {
+            append_line(out, "%s{thread=\"exited\"} %" PRIu64 "\n", name.c_str(), value);
+          } else {
+            append_line(out, "%s{thread=\"%" PRIu32 "\"} %" PRIu64 "\n", name.c_str(), thread, value);
+          }
+        }
+        continue;
+      }
+      append_line(out, "%s %" PRIu64 "\n", name.c_str(), snapshot[counter]);
+    }
+    return out;
+  }
+
+#ifndef _WIN32
+  MetricsServer::MetricsServer(MetricsServerOptions options, ChainViewSource chain) : chain_(std::move(chain)) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) throw std::system_error(errno, std::generic_category(), "MetricsServer: socket failed");
+    auto fail = [&](int err, const char* what) {
+      ::close(listen_fd_);
+      throw std::system_error(err, std::generic_category(), what);
+    };
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    if (::inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1) fail(EINVAL, "MetricsServer: bad host");
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+      fail(errno, "MetricsServer: bind failed");
+    }
+    if (::listen(listen_fd_, 16) != 0) fail(errno, "MetricsServer: listen failed");
+    socklen_t len = sizeof(addr);
+    if (::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+      fail(errno, "MetricsServer: getsockname failed");
+    }
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::thread([this] { run(); });
+  }
+
+  MetricsServer::~MetricsServer() {
+    stopping_.store(true);
+    if (thread_.joinable()) thread_.join();
+    ::close(listen_fd_);
+  }
+
+  // Polls so that shutdown is noticed within a tenth of a second.
+  void MetricsServer::run() {
+    ASTRO_TRACE_THREAD("metrics-http");
+    while (!stopping_.load()) {
+      pollfd listening{listen_fd_, POLLIN, 0};
+      if (::poll(&listening, 1, 100) <= 0) continue;
+      const int client = ::accept(listen_fd_, nullptr, nullptr);
+      if (client < 0) continue;
+      serve(client);
+      ::close(client);
+    }
+  }
+
+  void MetricsServer::serve(int client) {
+    // A slow or silent client holds up the next scrape by a second at most.
+    timeval timeout{1, 0};
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos) {
+      const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+      if (n <= 0) break;
+      request.append(buffer, static_cast<size_t>(n));
+    }
+    std::string_view line(request);
+    line = line.substr(0, line.find("\r\n"));
+    const auto method_end = line.find(' ');
+    const auto method = line.substr(0, method_end);
+    auto path = method_end == std::string_view::npos ? std::string_view{} : line.substr(method_end + 1);
+    path = path.substr(0, path.find_first_of(" ?"));
+
+    const char* status = "200 OK";
+    std::string body;
+    if (method != "GET") {
+      status = "405 Method Not Allowed";
+    } else if (path != "/metrics") {
+      status = "404 Not Found";
+    } else {
+      ASTRO_TRACE_SPAN("metrics.scrape");
+      auto view = chain_ ? chain_() : nullptr;
+      const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+      body = render_metrics(view.get(), static_cast<uint64_t>(now));
+    }
+    std::string response = "HTTP/1.0 ";
+    response += status;
+    response += "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: ";
+    response += std::to_string(body.size());
+    response += "\r\nConnection: close\r\n\r\n";
+    response += body;
+    for (size_t sent = 0; sent < response.size();) {
+      const ssize_t n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      sent += static_cast<size_t>(n);
+    }
+  }
+#else
+  MetricsServer::MetricsServer(MetricsServerOptions, ChainViewSource chain) : chain_(std::move(chain)) {
+    throw std::system_error(std::make_error_code(std::errc::function_not_supported), "MetricsServer");
+  }
+
+  MetricsServer::~MetricsServer() = default;
+  void MetricsServer::run() {}
+  void MetricsServer::serve(int) {}
+#endif
+}
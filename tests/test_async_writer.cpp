@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include "astro/storage/async_writer.hpp"
+#include "astro/storage/block_store.hpp"
+#include "astro/core/chain.hpp"
+#include "astro/core/keys.hpp"
+
+using namespace astro::core;
+namespace fs = std::filesystem;
+
+static fs::path tmpdir(const char* name) {
+  auto p = fs::temp_directory_path() / (std::string("astro_") + name);
+  fs::remove_all(p);
+  fs::create_directories(p);
+  return p;
+}
+
+static Block next_block(const Chain& c, const KeyPair& kp) {
+  Transaction tx; tx.version=1; tx.nonce=c.height(); tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+  return c.build_block_from_transactions({tx}, 1700000000ULL + c.height());
+}
+
+// Storage whose every write fails, as on a full or vanished disk.
+struct FailingStorage : astro::storage::BlockStorage {
+  void append_block(const Block&) override { throw std::runtime_error("disk gone"); }
+  void append_blocks(std::span<const Block>) override { throw std::runtime_error("disk gone"); }
+  std::vector<Block> load_all_blocks() override { return {}; }
+  void clear() override {}
+  size_t record_count() const override { return 0; }
+};
+
+TEST(AsyncWriter, AppendsBecomeDurableInOrder) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("async_writer");
+  auto kp = generate_ec_keypair();
+  Chain c;
+  std::vector<std::future<void>> durable;
+  {
+    astro::storage::BlockStore store(dir);
+    astro::storage::AsyncBlockWriter writer(store);
+    auto r0 = c.append_and_store_async(make_genesis_block("g", 1700000000ULL), writer);
+    ASSERT_TRUE(r0.validation.is_valid);
+    durable.push_back(std::move(r0.durable));
+    for (int i = 0; i < 20; ++i) {
+      auto r = c.append_and_store_async(next_block(c, kp), writer);
+      ASSERT_TRUE(r.validation.is_valid);
+      durable.push_back(std::move(r.durable));
+    }
+    // The in-memory chain doesn't wait for the disk.
+    EXPECT_EQ(c.height(), 21u);
+    for (auto& f : durable) EXPECT_NO_THROW(f.get());
+    EXPECT_GE(writer.commits(), 1u);
+    EXPECT_LE(writer.commits(), 21u);
+  }
+
+  astro::storage::BlockStore reopened(dir);
+  Chain c2;
+  c2.restore_from_store(reopened);
+  ASSERT_EQ(c2.height(), c.height());
+  EXPECT_EQ(c2.tip_hash(), c.tip_hash());
+}
+
+TEST(AsyncWriter, InvalidBlockIsNotQueued) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("async_writer_invalid");
+  astro::storage::BlockStore store(dir);
+  astro::storage::AsyncBlockWriter writer(store);
+  Chain c;
+  ASSERT_TRUE(c.append_and_store_async(make_genesis_block("g", 1700000000ULL), writer).validation.is_valid);
+  Block bad = make_genesis_block("again", 1700000001ULL);
+  auto r = c.append_and_store_async(bad, writer);
+  EXPECT_FALSE(r.validation.is_valid);
+  EXPECT_FALSE(r.durable.valid());
+  writer.flush();
+  EXPECT_EQ(store.record_count(), 1u);
+}
+
+TEST(AsyncWriter, WriteFailureSurfacesAndSticks) {
+  ASSERT_TRUE(crypto_init());
+  FailingStorage store;
+  astro::storage::AsyncBlockWriter writer(store);
+
+  Chain c;
+  auto r0 = c.append_and_store_async(make_genesis_block("g", 1700000000ULL), writer);
+  ASSERT_TRUE(r0.validation.is_valid);
+  EXPECT_THROW(r0.durable.get(), std::exception);
+  EXPECT_TRUE(writer.failed());
+
+  auto kp = generate_ec_keypair();
+  auto r1 = c.append_and_store_async(next_block(c, kp), writer);
+  ASSERT_TRUE(r1.validation.is_valid);
+  EXPECT_THROW(r1.durable.get(), std::exception);
+}
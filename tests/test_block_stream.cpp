@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "astro/core/block_stream.hpp"
+#include "astro/core/keys.hpp"
+#include "astro/core/merkle.hpp"
+
+using namespace astro::core;
+
+// Feeds `bytes` in `chunk`-sized pieces; false once the validator rejects.
+static ValidationResult stream(BlockStreamValidator& validator, const std::vector<uint8_t>& bytes, size_t chunk) {
+  for (size_t at = 0; at < bytes.size(); at += chunk) {
+    const auto piece = std::span<const uint8_t>(bytes).subspan(at, std::min(chunk, bytes.size() - at));
+    if (!validator.feed(piece)) break;
+  }
+  return validator.finish();
+}
+
+static std::vector<Transaction> signed_transactions(size_t count, uint64_t first_nonce = 1) {
+  auto kp = generate_ec_keypair();
+  std::vector<Transaction> txs;
+  for (size_t i = 0; i < count; ++i) {
+    Transaction tx; tx.version=1; tx.nonce=first_nonce+i; tx.amount=i; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="to-" + std::to_string(i);
+    tx.sign(kp.privkey_pem);
+    txs.push_back(std::move(tx));
+  }
+  return txs;
+}
+
+TEST(MerkleAccumulator, MatchesRoot) {
+  std::vector<Hash256> leaves;
+  MerkleAccumulator accumulator;
+  EXPECT_EQ(accumulator.root(), root(leaves));
+  for (int i = 0; i < 70; ++i) {
+    leaves.push_back(sha256(std::to_string(i)));
+    accumulator.add(leaves.back());
+    ASSERT_EQ(accumulator.root(), root(leaves)) << leaves.size() << " leaves";
+  }
+  EXPECT_EQ(accumulator.size(), 70u);
+}
+
+TEST(BlockStream, AcceptsWhatValidateBlockAccepts) {
+  ASSERT_TRUE(crypto_init());
+  Chain chain;
+  const auto genesis = make_genesis_block("g", 1700000000ULL);
+  {
+    BlockStreamValidator validator(chain);
+    EXPECT_TRUE(stream(validator, genesis.serialize(), 1).is_valid);
+  }
+  ASSERT_TRUE(chain.append_block(genesis).is_valid);
+
+  const auto block = chain.build_block_from_transactions(signed_transactions(9), 1700000001ULL);
+  ASSERT_TRUE(chain.validate_block(block).is_valid);
+  const auto bytes = block.serialize();
+  for (size_t threads : {0u, 3u}) {
+    for (size_t chunk : {size_t{1}, size_t{7}, size_t{100}, bytes.size()}) {
+      BlockStreamValidator validator(chain, {}, threads);
+      const auto result = stream(validator, bytes, chunk);
+      EXPECT_TRUE(result.is_valid) << threads << " threads, " << chunk << "-byte chunks";
+      ASSERT_TRUE(validator.header().has_value());
+      EXPECT_EQ(*validator.header(), block.header);
+    }
+  }
+}
+
+TEST(BlockStream, RejectsWhatValidateBlockRejects) {
+  ASSERT_TRUE(crypto_init());
+  Chain chain(ChainConfig{.track_ledger = true});
+  ASSERT_TRUE(chain.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  ASSERT_TRUE(chain.append_block(chain.build_block_from_transactions(signed_transactions(1, 5), 1700000001ULL)).is_valid);
+
+  auto expect_rejected = [&](const Block& block, ValidationError error, size_t index) {
+    ASSERT_EQ(chain.validate_block(block).error, error);
+    for (size_t threads : {0u, 2u}) {
+      BlockStreamValidator validator(chain, {}, threads);
+      const auto result = stream(validator, block.serialize(), 64);
+      EXPECT_FALSE(result.is_valid);
+      EXPECT_EQ(result.error, error) << threads << " threads";
+      EXPECT_EQ(result.transaction_index, index) << threads << " threads";
+    }
+  };
+
+  auto block = chain.build_block_from_transactions(signed_transactions(6), 1700000002ULL);
+  auto bad_merkle = block;
+  bad_merkle.header.merkle_root = {};
+  expect_rejected(bad_merkle, ValidationError::BadMerkleRoot, ~0ull);
+
+  auto bad_signature = block;
+  bad_signature.transactions[4].signature[5] ^= 0x01;
+  bad_signature.header.merkle_root = compute_merkle_root(bad_signature.transactions);
+  expect_rejected(bad_signature, ValidationError::BadTransactionSignature, 4);
+
+  auto coinbase = block;
+  coinbase.transactions[2].from_pub_pem.clear();
+  coinbase.header.merkle_root = compute_merkle_root(coinbase.transactions);
+  expect_rejected(coinbase, ValidationError::CoinbaseInNonGenesisBlock, 2);
+
+  auto bad_link = block;
+  bad_link.header.prev_hash = {};
+  expect_rejected(bad_link, ValidationError::BadPrevLink, ~0ull);
+
+  // The same key and nonce twice in one block.
+  auto kp = generate_ec_keypair();
+  Transaction tx; tx.nonce=3; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+  auto repeated = chain.build_block_from_transactions({tx, tx}, 1700000002ULL);
+  expect_rejected(repeated, ValidationError::ReplayedNonce, 1);
+}
+
+TEST(BlockStream, TurnsAwayBadBytesEarly) {
+  ASSERT_TRUE(crypto_init());
+  Chain chain;
+  ASSERT_TRUE(chain.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  const auto block = chain.build_block_from_transactions(signed_transactions(4), 1700000001ULL);
+  const auto bytes = block.serialize();
+
+  {  // Too little work: rejected on the header alone.
+    chain.set_difficulty_bits(24);
+    BlockStreamValidator validator(chain);
+    EXPECT_FALSE(validator.feed(std::span<const uint8_t>(bytes).first(BLOCK_HEADER_BYTES)));
+    EXPECT_EQ(validator.finish().error, ValidationError::InsufficientPOW);
+    chain.set_difficulty_bits(0);
+  }
+  {  // A transaction over the limit, before its bytes arrive.
+    BlockStreamValidator validator(chain, {.max_transaction_bytes = 64});
+    EXPECT_FALSE(validator.feed(std::span<const uint8_t>(bytes).first(BLOCK_HEADER_BYTES + 8)));
+    EXPECT_EQ(validator.finish().error, ValidationError::OversizedBlock);
+    EXPECT_EQ(validator.finish().transaction_index, 0u);
+  }
+  {  // More transactions than the block limit leaves room for.
+    auto lying = bytes;
+    lying[BLOCK_HEADER_BYTES + 3] = 0x7f;
+    BlockStreamValidator validator(chain);
+    EXPECT_FALSE(validator.feed(std::span<const uint8_t>(lying).first(BLOCK_HEADER_BYTES + 4)));
+    EXPECT_EQ(validator.finish().error, ValidationError::OversizedBlock);
+  }
+  {
+    BlockStreamValidator validator(chain, {.max_block_bytes = bytes.size() - 1});
+    EXPECT_EQ(stream(validator, bytes, 256).error, ValidationError::OversizedBlock);
+  }
+  {  // Truncated, then with a byte too many.
+    BlockStreamValidator truncated(chain);
+    EXPECT_TRUE(truncated.feed(std::span<const uint8_t>(bytes).first(bytes.size() - 1)));
+    EXPECT_EQ(truncated.finish().error, ValidationError::MalformedBlock);
+    auto extended = bytes;
+    extended.push_back(0);
+    BlockStreamValidator trailing(chain);
+    EXPECT_EQ(stream(trailing, extended, extended.size()).error, ValidationError::MalformedBlock);
+  }
+  {  // A field length running past its transaction.
+    auto overrun = bytes;
+    overrun[BLOCK_HEADER_BYTES + 4 + 4 + 29] = 0xff;  // from_pub_pem's length, high byte
+    BlockStreamValidator validator(chain);
+    const auto result = stream(validator, overrun, overrun.size());
+    EXPECT_EQ(result.error, ValidationError::MalformedBlock);
+    EXPECT_EQ(result.transaction_index, 0u);
+  }
+}
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
+#include <atomic>
 #include <chrono>
+#include <stdexcept>
+#include <thread>
 #include "astro/core/chain.hpp"
 #include "astro/core/keys.hpp"
+#include "astro/core/metrics.hpp"
 
 using namespace astro::core;
 
@@ -102,4 +106,196 @@ TEST(Chain, RejectsCoinbaseInNonGenesis) {
   auto r = c.append_block(b);
   EXPECT_FALSE(r.is_valid);
   EXPECT_EQ(r.error, ValidationError::CoinbaseInNonGenesisBlock);
-} 
\ No newline at end of file
+} 
+TEST(Chain, ValidatesCheapestStageFirst) {
+  ASSERT_TRUE(crypto_init());
+  Chain c;
+  uint64_t t = now_sec();
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", t)).is_valid);
+
+  auto kp = generate_ec_keypair();
+  Transaction tx; tx.version=1; tx.nonce=1; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+  Block b = c.build_block_from_transactions({tx}, t+1);
+  b.transactions[0].signature[0] ^= 0x01;
+  c.reset_validation_stats();
+
+  // Bad signature: every stage runs, the last one rejects.
+  EXPECT_EQ(c.validate_block(b).error, ValidationError::BadTransactionSignature);
+  EXPECT_EQ(c.validation_stats().signatures.runs, 1u);
+  EXPECT_EQ(c.validation_stats().signatures.rejected, 1u);
+
+  // Bad merkle root as well: rejected before any signature is checked.
+  b.header.merkle_root = {};
+  EXPECT_EQ(c.validate_block(b).error, ValidationError::BadMerkleRoot);
+  EXPECT_EQ(c.validation_stats().structure.rejected, 1u);
+  EXPECT_EQ(c.validation_stats().signatures.runs, 1u);
+
+  // And bad linkage: the body is never looked at.
+  b.header.prev_hash = {};
+  EXPECT_EQ(c.validate_block(b).error, ValidationError::BadPrevLink);
+  EXPECT_EQ(c.validation_stats().header.runs, 3u);
+  EXPECT_EQ(c.validation_stats().header.rejected, 1u);
+  EXPECT_EQ(c.validation_stats().structure.runs, 2u);
+  EXPECT_EQ(c.validation_stats().signatures.runs, 1u);
+  if (metrics::enabled) {
+    EXPECT_GT(c.validation_stats().signatures.nanos, 0u);
+  }
+}
+
+TEST(Chain, PruningKeepsHeadersAndRecentBodies) {
+  ASSERT_TRUE(crypto_init());
+  Chain c(ChainConfig{.keep_recent_bodies = 3});
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  auto kp = generate_ec_keypair();
+  for (uint64_t h = 1; h < 8; ++h) {
+    Transaction tx; tx.version=1; tx.nonce=h; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    ASSERT_TRUE(c.append_block(c.build_block_from_transactions({tx}, 1700000000ULL + h)).is_valid);
+  }
+  EXPECT_EQ(c.height(), 8u);
+  EXPECT_EQ(c.pruned_height(), 5u);
+  for (size_t h = 0; h < c.height(); ++h) {
+    EXPECT_EQ(c.block_at(h)->transactions.empty(), h < 5) << h;
+  }
+  // Headers still link, so new blocks validate as before.
+  EXPECT_EQ(c.block_at(5)->header.prev_hash, c.block_at(4)->header.hash());
+  Transaction tx; tx.version=1; tx.nonce=9; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+  auto bad = c.build_block_from_transactions({tx}, 1700000009ULL);
+  bad.header.prev_hash = c.block_at(3)->header.hash();
+  EXPECT_EQ(c.append_block(bad).error, ValidationError::BadPrevLink);
+
+  Chain budget(ChainConfig{.body_byte_budget = 1});
+  ASSERT_TRUE(budget.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  ASSERT_TRUE(budget.append_block(budget.build_block_from_transactions({tx}, 1700000001ULL)).is_valid);
+  EXPECT_EQ(budget.pruned_height(), 1u); // the tip always keeps its body
+  EXPECT_GT(budget.retained_body_bytes(), 1u);
+}
+
+TEST(Chain, FindsBlocksByHash) {
+  ASSERT_TRUE(crypto_init());
+  Chain c;
+  EXPECT_FALSE(c.find_by_hash(Hash256{}).has_value());
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  auto kp = generate_ec_keypair();
+  for (uint64_t h = 1; h < 6; ++h) {
+    Transaction tx; tx.version=1; tx.nonce=h; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    ASSERT_TRUE(c.append_block(c.build_block_from_transactions({tx}, 1700000000ULL + h)).is_valid);
+  }
+  for (size_t h = 0; h < c.height(); ++h) {
+    const auto hash = c.block_at(h)->header.hash();
+    EXPECT_EQ(c.hash_at(h), hash);
+    EXPECT_EQ(c.find_by_hash(hash), h);
+  }
+  EXPECT_EQ(c.tip_hash(), c.hash_at(5));
+  EXPECT_FALSE(c.hash_at(6).has_value());
+  EXPECT_FALSE(c.find_by_hash(c.block_at(5)->header.merkle_root).has_value());
+}
+
+TEST(Chain, FindsTransactionsWithMerkleProof) {
+  ASSERT_TRUE(crypto_init());
+  Chain c(ChainConfig{.index_transactions = true});
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  auto kp = generate_ec_keypair();
+  std::vector<Transaction> txs;
+  for (uint64_t n = 0; n < 5; ++n) {
+    Transaction tx; tx.version=1; tx.nonce=n; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    txs.push_back(tx);
+  }
+  ASSERT_TRUE(c.append_block(c.build_block_from_transactions(txs, 1700000001ULL)).is_valid);
+
+  for (size_t i = 0; i < txs.size(); ++i) {
+    auto found = c.find_transaction(txs[i].tx_hash());
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->height, 1u);
+    EXPECT_EQ(found->index, i);
+    ASSERT_TRUE(found->proof.has_value());
+    EXPECT_TRUE(verify_proof(txs[i].tx_hash(), *found->proof, c.block_at(1)->header.merkle_root));
+  }
+  EXPECT_EQ(c.find_transaction(c.block_at(0)->transactions[0].tx_hash())->height, 0u);
+  EXPECT_FALSE(c.find_transaction(Hash256{}).has_value());
+
+  Chain unindexed;
+  ASSERT_TRUE(unindexed.append_block(*c.block_at(0)).is_valid);
+  EXPECT_FALSE(unindexed.find_transaction(c.block_at(0)->transactions[0].tx_hash()).has_value());
+}
+
+TEST(Chain, LedgerRejectsReplayedNonces) {
+  ASSERT_TRUE(crypto_init());
+  auto kp = generate_ec_keypair();
+  auto make_tx = [&](uint64_t nonce) {
+    Transaction tx; tx.version=1; tx.nonce=nonce; tx.amount=3; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    return tx;
+  };
+  EXPECT_THROW(Chain(ChainConfig{.keep_recent_bodies = 3, .track_ledger = true}), std::invalid_argument);
+  Chain c(ChainConfig{.track_ledger = true});
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  ASSERT_TRUE(c.append_block(c.build_block_from_transactions({make_tx(1)}, 1700000001ULL)).is_valid);
+  ASSERT_NE(c.ledger(), nullptr);
+  EXPECT_EQ(c.ledger()->sender(hash160(kp.pubkey_pem))->last_nonce, 1u);
+  EXPECT_EQ(c.ledger()->received("x"), 3u);
+
+  auto replay = c.build_block_from_transactions({make_tx(1)}, 1700000002ULL);
+  auto result = c.validate_block(replay);
+  EXPECT_FALSE(result.is_valid);
+  EXPECT_EQ(result.error, ValidationError::ReplayedNonce);
+  EXPECT_EQ(c.append_block(replay).error, ValidationError::ReplayedNonce);
+  EXPECT_EQ(c.height(), 2u);
+  EXPECT_TRUE(c.append_block(c.build_block_from_transactions({make_tx(2)}, 1700000002ULL)).is_valid);
+  EXPECT_EQ(c.ledger()->received("x"), 6u);
+
+  Chain untracked;
+  EXPECT_EQ(untracked.ledger(), nullptr);
+}
+
+TEST(Chain, ViewsStayFixedWhileTheChainGrows) {
+  Chain c;
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  auto first = c.view();
+  for (uint64_t h = 1; h < ChainView::CHUNK_BLOCKS + 10; ++h) {
+    ASSERT_TRUE(c.append_block(c.build_block_from_transactions({}, 1700000000ULL + h)).is_valid);
+  }
+  EXPECT_EQ(first->height(), 1u);
+  EXPECT_EQ(first->tip_hash(), c.hash_at(0));
+  EXPECT_EQ(c.view_height(), c.height());
+
+  auto latest = c.view();
+  ASSERT_EQ(latest->height(), c.height());
+  for (size_t h = 0; h < c.height(); ++h) {
+    EXPECT_EQ(latest->header_at(h), c.block_at(h)->header);
+    EXPECT_EQ(latest->hash_at(h), c.hash_at(h));
+  }
+  EXPECT_EQ(latest->build_block_from_transactions({}, 1).header.prev_hash, c.tip_hash());
+
+  // A copy appends into storage of its own.
+  Chain copy = c;
+  ASSERT_TRUE(copy.append_block(copy.build_block_from_transactions({}, 1800000000ULL)).is_valid);
+  ASSERT_TRUE(c.append_block(c.build_block_from_transactions({}, 1800000001ULL)).is_valid);
+  EXPECT_EQ(latest->height(), c.height() - 1);
+  EXPECT_EQ(c.view()->tip_hash(), c.tip_hash());
+  EXPECT_EQ(copy.view()->tip_hash(), copy.tip_hash());
+  EXPECT_NE(c.tip_hash(), copy.tip_hash());
+}
+
+TEST(Chain, ViewsCanBeReadWhileAppending) {
+  Chain c;
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  std::atomic<bool> done{false};
+  std::atomic<size_t> bad{0};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; ++r) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        auto view = c.view();
+        const size_t h = view->height() - 1;
+        if (view->header_at(h).hash() != view->hash_at(h)) ++bad;
+        if (h > 0 && view->header_at(h).prev_hash != view->hash_at(h - 1)) ++bad;
+      }
+    });
+  }
+  for (uint64_t h = 1; h < 3000; ++h) {
+    ASSERT_TRUE(c.append_block(c.build_block_from_transactions({}, 1700000000ULL + h)).is_valid);
+  }
+  done = true;
+  for (auto& reader : readers) reader.join();
+  EXPECT_EQ(bad.load(), 0u);
+  EXPECT_EQ(c.view()->height(), 3000u);
+}
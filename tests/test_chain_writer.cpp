@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "astro/core/chain_writer.hpp"
+#include "astro/core/keys.hpp"
+#include "astro/storage/block_store.hpp"
+
+using namespace astro::core;
+namespace fs = std::filesystem;
+
+static fs::path tmpdir(const char* name) {
+  auto p = fs::temp_directory_path() / (std::string("astro_") + name);
+  fs::remove_all(p);
+  fs::create_directories(p);
+  return p;
+}
+
+static Block empty_block_on(const ChainView& view, uint64_t salt) {
+  return view.build_block_from_transactions({}, view.tip_header()->timestamp + 1 + salt);
+}
+
+TEST(ChainWriter, CompetingProducersGetOneBlockPerHeight) {
+  auto dir = tmpdir("chain_writer");
+  constexpr int PRODUCERS = 4;
+  constexpr int ROUNDS = 50;
+  std::atomic<size_t> accepted{0};
+  uint64_t commits = 0;
+  {
+    astro::storage::BlockStore store(dir);
+    ChainWriter writer(Chain{}, store);
+    ASSERT_TRUE(writer.submit(make_genesis_block("g", 1700000000ULL)).get().is_valid);
+
+    // Producers race to extend whatever tip they last saw; the losers'
+    // blocks no longer link and are turned away.
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+      producers.emplace_back([&, p] {
+        for (int round = 0; round < ROUNDS; ++round) {
+          auto result = writer.submit(empty_block_on(*writer.view(), p)).get();
+          if (result.is_valid) ++accepted;
+          else EXPECT_EQ(result.error, ValidationError::BadPrevLink);
+        }
+      });
+    }
+    for (auto& producer : producers) producer.join();
+    writer.flush();
+    EXPECT_GE(accepted.load(), size_t{ROUNDS});
+    EXPECT_EQ(writer.view()->height(), accepted.load() + 1);
+    commits = writer.commits();
+    EXPECT_LE(commits, accepted.load() + 1);
+  }
+
+  astro::storage::BlockStore reopened(dir);
+  Chain restored;
+  restored.restore_from_store(reopened);
+  EXPECT_EQ(restored.height(), accepted.load() + 1);
+}
+
+TEST(ChainWriter, RejectedBlockDoesNotSinkItsBatch) {
+  astro::storage::BlockStore store(tmpdir("chain_writer_batch"));
+  Chain seed;
+  ASSERT_TRUE(seed.append_and_store(make_genesis_block("g", 1700000000ULL), store).is_valid);
+  Block b1 = seed.build_block_from_transactions({}, 1700000001ULL);
+  Block stale = seed.build_block_from_transactions({}, 1700000002ULL);  // competes with b1
+  Chain ahead = seed;
+  ASSERT_TRUE(ahead.append_block(b1).is_valid);
+  Block b2 = ahead.build_block_from_transactions({}, 1700000003ULL);
+
+  ChainWriter writer(std::move(seed), store);
+  auto r1 = writer.submit(b1);
+  auto r_stale = writer.submit(stale);
+  auto r2 = writer.submit(b2);
+  EXPECT_TRUE(r1.get().is_valid);
+  EXPECT_EQ(r_stale.get().error, ValidationError::BadPrevLink);
+  EXPECT_TRUE(r2.get().is_valid);
+  writer.flush();
+  EXPECT_EQ(writer.view()->height(), 3u);
+  EXPECT_EQ(store.record_count(), 3u);
+}
+
+struct FailingStorage : astro::storage::BlockStorage {
+  void append_block(const Block&) override { throw std::runtime_error("disk gone"); }
+  void append_blocks(std::span<const Block>) override { throw std::runtime_error("disk gone"); }
+  std::vector<Block> load_all_blocks() override { return {}; }
+  void clear() override {}
+  size_t record_count() const override { return 0; }
+};
+
+TEST(ChainWriter, StoreFailureIsReported) {
+  FailingStorage store;
+  ChainWriter writer(Chain{}, store);
+  auto result = writer.submit(make_genesis_block("g", 1700000000ULL)).get();
+  EXPECT_FALSE(result.is_valid);
+  EXPECT_EQ(result.error, ValidationError::None);
+  EXPECT_EQ(writer.view()->height(), 0u);
+}
+
+TEST(ChainWriter, ThrowingBlockFailsItsFutureAndWriterGoesOn) {
+  ASSERT_TRUE(crypto_init());
+  astro::storage::BlockStore store(tmpdir("chain_writer_throw"));
+  ChainWriter writer(Chain{}, store);
+  ASSERT_TRUE(writer.submit(make_genesis_block("g", 1700000000ULL)).get().is_valid);
+
+  // A sender key that doesn't parse makes signature checking throw.
+  Transaction tx; tx.nonce=1; tx.from_pub_pem.assign(64, 'x'); tx.to_label="x"; tx.signature.assign(70, 0);
+  auto garbage = writer.view()->build_block_from_transactions({tx}, 1700000001ULL);
+  EXPECT_ANY_THROW(writer.submit(std::move(garbage)).get());
+
+  EXPECT_TRUE(writer.submit(empty_block_on(*writer.view(), 0)).get().is_valid);
+  EXPECT_EQ(writer.view()->height(), 2u);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "astro/storage/compression.hpp"
+
+using namespace astro::storage;
+
+static std::vector<uint8_t> round_trip(const std::vector<uint8_t>& raw) {
+  std::vector<uint8_t> packed, unpacked;
+  lz4_compress(raw, packed);
+  lz4_decompress(packed, raw.size(), unpacked);
+  return unpacked;
+}
+
+TEST(Lz4, RoundTripsAssortedInputs) {
+  std::mt19937 rng(7);
+  std::vector<std::vector<uint8_t>> inputs = {{}, {42}, std::vector<uint8_t>(13, 'a'), std::vector<uint8_t>(100000, 0)};
+  std::vector<uint8_t> noise(5000);
+  for (auto& b : noise) b = static_cast<uint8_t>(rng());
+  inputs.push_back(noise);
+  std::string text;
+  for (int i = 0; i < 200; ++i) text += "-----BEGIN PUBLIC KEY-----\nrecipient-" + std::to_string(i % 7) + "\n";
+  inputs.emplace_back(text.begin(), text.end());
+  // Short-offset overlapping matches ("abcabcabc...").
+  std::vector<uint8_t> runs;
+  for (int i = 0; i < 3000; ++i) runs.push_back(static_cast<uint8_t>("abc"[i % 3]));
+  inputs.push_back(runs);
+
+  for (const auto& raw : inputs) EXPECT_EQ(round_trip(raw), raw);
+}
+
+TEST(Lz4, ShrinksRepetitiveData) {
+  std::string text;
+  for (int i = 0; i < 100; ++i) text += "-----BEGIN PUBLIC KEY-----\n";
+  std::vector<uint8_t> raw(text.begin(), text.end()), packed;
+  EXPECT_TRUE(compress(Compression::Lz4, raw, packed));
+  EXPECT_LT(packed.size() * 10, raw.size());
+  EXPECT_FALSE(compress(Compression::None, raw, packed));
+}
+
+TEST(Lz4, RejectsCorruptInput) {
+  std::vector<uint8_t> raw(1000, 'x'), packed, out;
+  lz4_compress(raw, packed);
+  EXPECT_THROW(lz4_decompress(packed, raw.size() + 1, out), std::runtime_error);
+  EXPECT_THROW(lz4_decompress(std::span<const uint8_t>(packed).first(packed.size() - 1), raw.size(), out),
+               std::runtime_error);
+  std::vector<uint8_t> bad_offset{0x10, 'a', 0x05, 0x00}; // one literal, then offset 5
+  EXPECT_THROW(lz4_decompress(bad_offset, 10, out), std::runtime_error);
+}
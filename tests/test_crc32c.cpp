@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "astro/core/crc32c.hpp"
+
+using namespace astro::core;
+
+static std::span<const uint8_t> bytes_of(const std::string& s) {
+  return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+TEST(Crc32c, KnownVectors) {
+  EXPECT_EQ(crc32c(bytes_of("")), 0x00000000u);
+  EXPECT_EQ(crc32c(bytes_of("123456789")), 0xE3069283u);
+  std::vector<uint8_t> zeros(32, 0x00);
+  EXPECT_EQ(crc32c(std::span<const uint8_t>(zeros.data(), zeros.size())), 0x8A9136AAu);
+  std::vector<uint8_t> ones(32, 0xFF);
+  EXPECT_EQ(crc32c(std::span<const uint8_t>(ones.data(), ones.size())), 0x62A8AB43u);
+}
+
+TEST(Crc32c, SoftwareMatchesDispatchAndExtends) {
+  std::vector<uint8_t> data(1031);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 131 + 7);
+  for (size_t len : {0u, 1u, 7u, 8u, 9u, 63u, 64u, 1031u}) {
+    std::span<const uint8_t> s(data.data(), len);
+    EXPECT_EQ(crc32c(s), crc32c_software(s)) << "len=" << len;
+  }
+  std::span<const uint8_t> all(data.data(), data.size());
+  auto head = all.first(500);
+  auto tail = all.subspan(500);
+  EXPECT_EQ(crc32c(tail, crc32c(head)), crc32c(all));
+  EXPECT_EQ(crc32c_software(tail, crc32c_software(head)), crc32c(all));
+}
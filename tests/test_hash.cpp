@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <unordered_map>
 #include "astro/core/hash.hpp"
 
 using namespace astro::core;
@@ -33,4 +35,17 @@ TEST(HashTests, Hash160_EmptyString) {
 TEST(HashTests, ToHex_FormatsLeadingZeros) {
   std::vector<uint8_t> data{0x00, 0x01, 0x0A, 0xFF};
   EXPECT_EQ(toHex(data), "00010aff");
-}
\ No newline at end of file
+}
+
+TEST(HashTests, DigestHasherSpreadsProofOfWorkHashes) {
+  // Block hashes at a high difficulty: the first eight bytes are all zero.
+  std::unordered_map<Hash256, size_t, DigestHasher> heights;
+  for (size_t i = 0; i < 4096; ++i) {
+    auto hash = sha256("block " + std::to_string(i));
+    std::fill(hash.begin(), hash.begin() + 8, 0);
+    heights.emplace(hash, i);
+  }
+  size_t largest = 0;
+  for (size_t b = 0; b < heights.bucket_count(); ++b) largest = std::max(largest, heights.bucket_size(b));
+  EXPECT_LE(largest, 16u);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "astro/core/ledger.hpp"
+#include "astro/core/keys.hpp"
+
+using namespace astro::core;
+
+static Transaction make_tx(const KeyPair& kp, uint64_t nonce, uint64_t amount, std::string to) {
+  Transaction tx; tx.version=1; tx.nonce=nonce; tx.amount=amount; tx.from_pub_pem=kp.pubkey_pem; tx.to_label=std::move(to);
+  return tx;
+}
+
+TEST(Ledger, TracksBalancesAndRejectsReplayedNonces) {
+  ASSERT_TRUE(crypto_init());
+  auto alice = generate_ec_keypair();
+  auto bob = generate_ec_keypair();
+  const auto alice_key = hash160(alice.pubkey_pem);
+  Ledger ledger;
+
+  Block genesis = make_genesis_block("g", 1700000000ULL);
+  ASSERT_TRUE(ledger.apply(genesis));
+  EXPECT_EQ(ledger.sender_count(), 0u);
+
+  Block b1;
+  b1.transactions = {make_tx(alice, 1, 10, "carol"), make_tx(bob, 7, 5, "carol"), make_tx(alice, 2, 1, "dave")};
+  Ledger::Undo undo;
+  ASSERT_TRUE(ledger.apply(b1, &undo));
+  ASSERT_NE(ledger.sender(alice_key), nullptr);
+  EXPECT_EQ(*ledger.sender(alice_key), (Ledger::Sender{11, 2, 2}));
+  EXPECT_EQ(ledger.received("carol"), 15u);
+  EXPECT_EQ(ledger.received("nobody"), 0u);
+
+  // Repeats, both against the ledger and within a block, change nothing.
+  const Ledger before = ledger;
+  Block replay;
+  replay.transactions = {make_tx(bob, 8, 1, "carol"), make_tx(alice, 2, 1, "carol")};
+  size_t bad_tx = ~0ull;
+  EXPECT_FALSE(ledger.check(replay, &bad_tx));
+  EXPECT_FALSE(ledger.apply(replay, nullptr, &bad_tx));
+  EXPECT_EQ(bad_tx, 1u);
+  Block twice;
+  twice.transactions = {make_tx(bob, 9, 1, "carol"), make_tx(bob, 9, 1, "carol")};
+  EXPECT_FALSE(ledger.apply(twice, nullptr, &bad_tx));
+  EXPECT_EQ(bad_tx, 1u);
+  EXPECT_EQ(ledger, before);
+
+  Block b2;
+  b2.transactions = {make_tx(alice, 5, 4, "carol")};
+  Ledger::Undo undo2;
+  ASSERT_TRUE(ledger.apply(b2, &undo2));
+  EXPECT_EQ(ledger.received("carol"), 19u);
+  ledger.undo(undo2);
+  EXPECT_EQ(ledger, before);
+  ledger.undo(undo);
+  EXPECT_EQ(ledger.sender(alice_key), nullptr);
+  EXPECT_EQ(ledger.received("carol"), 0u);
+  EXPECT_EQ(ledger.recipient_count(), 1u);  // the genesis note
+
+  ByteWriter writer;
+  before.write(writer);
+  ByteReader reader(writer.buffer());
+  EXPECT_EQ(Ledger::read(reader), before);
+  EXPECT_EQ(reader.remaining_bytes(), 0u);
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "astro/core/lru_cache.hpp"
+
+using namespace astro::core;
+
+TEST(LruCache, EvictsLeastRecentlyUsed) {
+  LruCache<int, std::string> cache(2);
+  cache.put(1, "one");
+  cache.put(2, "two");
+  ASSERT_NE(cache.find(1), nullptr);  // 2 is now the oldest
+  cache.put(3, "three");
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.find(2), nullptr);
+  EXPECT_EQ(*cache.find(1), "one");
+  EXPECT_EQ(*cache.find(3), "three");
+
+  cache.put(1, "uno");
+  EXPECT_EQ(*cache.find(1), "uno");
+  EXPECT_EQ(cache.size(), 2u);
+
+  LruCache<int, std::string> copy = cache;
+  cache.clear();
+  EXPECT_EQ(cache.find(1), nullptr);
+  ASSERT_NE(copy.find(3), nullptr);
+  copy.put(4, "four");  // evicts 1, the oldest after the lookup of 3
+  EXPECT_EQ(copy.find(1), nullptr);
+
+  LruCache<int, std::string> none;
+  none.put(1, "one");
+  EXPECT_EQ(none.find(1), nullptr);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <thread>
+#include "astro/core/chain.hpp"
+#include "astro/core/keys.hpp"
+#include "astro/core/metrics.hpp"
+#include "astro/storage/block_store.hpp"
+
+using namespace astro::core;
+namespace fs = std::filesystem;
+
+TEST(Metrics, BucketsArePowersOfTwo) {
+  using metrics::Histogram;
+  EXPECT_EQ(Histogram::bucket_of(0), 0u);
+  EXPECT_EQ(Histogram::bucket_of(1), 0u);
+  EXPECT_EQ(Histogram::bucket_of(2), 1u);
+  EXPECT_EQ(Histogram::bucket_of(1023), 9u);
+  EXPECT_EQ(Histogram::bucket_of(1024), 10u);
+  EXPECT_EQ(Histogram::bucket_of(~0ull), metrics::BUCKETS - 1);
+
+  Histogram h;
+  EXPECT_EQ(h.quantile_nanos(0.5), 0u);
+  h.count = 100;
+  h.buckets[3] = 90;   // [8, 16)
+  h.buckets[10] = 10;  // [1024, 2048)
+  EXPECT_EQ(h.quantile_nanos(0.5), 16u);
+  EXPECT_EQ(h.quantile_nanos(0.95), 2048u);
+}
+
+TEST(Metrics, SumsThreadsIncludingExitedOnes) {
+  if (!metrics::enabled) GTEST_SKIP() << "built without ASTRO_WITH_METRICS";
+  metrics::reset();
+  metrics::record(metrics::Timer::StoreFsync, 1500);
+  auto exited = [] {
+    for (const auto& [thread, value] : metrics::per_thread(metrics::Counter::StoreBlocksLoaded)) {
+      if (thread == 0) return value;
+    }
+    return uint64_t{0};
+  };
+  const uint64_t exited_before = exited();
+  std::thread([] {
+    metrics::record(metrics::Timer::StoreFsync, 3000);
+    metrics::add(metrics::Counter::StoreBlocksLoaded, 7);
+  }).join();
+  EXPECT_EQ(exited(), exited_before + 7);
+
+  auto snapshot = metrics::snapshot();
+  const auto& fsync = snapshot[metrics::Timer::StoreFsync];
+  EXPECT_EQ(fsync.count, 2u);
+  EXPECT_EQ(fsync.total_nanos, 4500u);
+  EXPECT_EQ(fsync.buckets[10], 1u);
+  EXPECT_EQ(fsync.buckets[11], 1u);
+  EXPECT_EQ(snapshot[metrics::Counter::StoreBlocksLoaded], 7u);
+
+  metrics::reset();
+  snapshot = metrics::snapshot();
+  EXPECT_EQ(snapshot[metrics::Timer::StoreFsync].count, 0u);
+  EXPECT_EQ(snapshot[metrics::Counter::StoreBlocksLoaded], 0u);
+  {
+    ASTRO_METRICS_TIMER(metrics::Timer::StoreLoad);
+  }
+  EXPECT_EQ(metrics::snapshot()[metrics::Timer::StoreLoad].count, 1u);
+}
+
+TEST(Metrics, CoverStoreAndValidationStages) {
+  if (!metrics::enabled) GTEST_SKIP() << "built without ASTRO_WITH_METRICS";
+  ASSERT_TRUE(crypto_init());
+  auto dir = fs::temp_directory_path() / "astro_metrics";
+  fs::remove_all(dir);
+  astro::storage::BlockStore store(dir);
+  metrics::reset();
+
+  Chain chain;
+  ASSERT_TRUE(chain.append_and_store(make_genesis_block("g", 1700000000ULL), store).is_valid);
+  auto kp = generate_ec_keypair();
+  Transaction tx; tx.version=1; tx.nonce=1; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+  ASSERT_TRUE(chain.append_and_store(chain.build_block_from_transactions({tx}, 1700000001ULL), store).is_valid);
+  EXPECT_EQ(store.load_all_blocks().size(), 2u);
+
+  auto snapshot = metrics::snapshot();
+  for (auto timer : {metrics::Timer::ValidateHeader, metrics::Timer::ValidateStructure, metrics::Timer::ValidateSignatures,
+                     metrics::Timer::StoreSerialize, metrics::Timer::StoreWrite, metrics::Timer::StoreFsync}) {
+    // Through io_uring the write and fsync are one submission, timed as store.write.
+    const bool merged = timer == metrics::Timer::StoreFsync && store.io_uring_active();
+    EXPECT_EQ(snapshot[timer].count, merged ? 0u : 2u) << metrics::name(timer);
+  }
+  EXPECT_EQ(snapshot[metrics::Timer::StoreLoad].count, 1u);
+  EXPECT_EQ(snapshot[metrics::Counter::StoreBlocksAppended], 2u);
+  EXPECT_EQ(snapshot[metrics::Counter::StoreBlocksLoaded], 2u);
+  EXPECT_GT(snapshot[metrics::Counter::StoreBytesAppended], 0u);
+  fs::remove_all(dir);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include "astro/core/chain.hpp"
+#include "astro/core/metrics.hpp"
+#include "astro/net/metrics_server.hpp"
+
+using namespace astro::core;
+using astro::net::MetricsServer;
+
+static std::string http_request(uint16_t port, const std::string& request) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return {};
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  std::string response;
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+    ::send(fd, request.data(), request.size(), 0);
+    char buffer[4096];
+    for (ssize_t n; (n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0;) response.append(buffer, static_cast<size_t>(n));
+  }
+  ::close(fd);
+  return response;
+}
+
+TEST(MetricsServer, RendersChainGaugesAndHistograms) {
+  Chain chain;
+  ASSERT_TRUE(chain.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  metrics::reset();
+  metrics::record(metrics::Timer::StoreFsync, 1500);
+  metrics::add(metrics::Counter::BlocksAccepted, 3);
+
+  auto view = chain.view();
+  const auto text = astro::net::render_metrics(view.get(), 1700000010ULL);
+  EXPECT_NE(text.find("# TYPE astro_chain_height gauge\nastro_chain_height 1\n"), std::string::npos);
+  EXPECT_NE(text.find("astro_chain_tip_age_seconds 10\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE astro_store_fsync_seconds histogram\n"), std::string::npos);
+  EXPECT_NE(text.find("astro_validate_signatures_seconds_bucket{le=\"+Inf\"}"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE astro_chain_body_cache_hits_total counter\n"), std::string::npos);
+  if (metrics::enabled) {
+    // 1500 ns lands in [1024, 2048).
+    EXPECT_NE(text.find("astro_store_fsync_seconds_bucket{le=\"1.024e-06\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("astro_store_fsync_seconds_bucket{le=\"2.048e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("astro_store_fsync_seconds_count 1\n"), std::string::npos);
+    EXPECT_NE(text.find("astro_chain_blocks_accepted_total 3\n"), std::string::npos);
+  }
+
+  const auto without_chain = astro::net::render_metrics(nullptr, 0);
+  EXPECT_EQ(without_chain.find("astro_chain_height"), std::string::npos);
+}
+
+TEST(MetricsServer, ServesMetricsOverHttp) {
+  Chain chain;
+  ASSERT_TRUE(chain.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  MetricsServer server({.host = "127.0.0.1", .port = 0}, [&chain] { return chain.view(); });
+  ASSERT_NE(server.port(), 0);
+
+  const auto ok = http_request(server.port(), "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  EXPECT_EQ(ok.rfind("HTTP/1.0 200 OK\r\n", 0), 0u) << ok.substr(0, 64);
+  EXPECT_NE(ok.find("Content-Type: text/plain; version=0.0.4\r\n"), std::string::npos);
+  EXPECT_NE(ok.find("\r\n\r\n"), std::string::npos);
+  EXPECT_NE(ok.find("astro_chain_height 1\n"), std::string::npos);
+
+  const auto missing = http_request(server.port(), "GET / HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(missing.rfind("HTTP/1.0 404 Not Found\r\n", 0), 0u) << missing.substr(0, 64);
+  const auto wrong_method = http_request(server.port(), "POST /metrics HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(wrong_method.rfind("HTTP/1.0 405", 0), 0u) << wrong_method.substr(0, 64);
+}
+
+TEST(MetricsServer, ThrowsWhenThePortIsTaken) {
+  MetricsServer first({.host = "127.0.0.1", .port = 0});
+  EXPECT_THROW(MetricsServer({.host = "127.0.0.1", .port = first.port()}), std::system_error);
+  EXPECT_THROW(MetricsServer({.host = "not-an-address", .port = 0}), std::system_error);
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "astro/core/mpsc_queue.hpp"
+
+using namespace astro::core;
+
+TEST(MpscQueue, KeepsEachProducersOrder) {
+  constexpr int PRODUCERS = 4;
+  constexpr int ITEMS = 20000;
+  MpscQueue<std::pair<int, int>> queue;
+  EXPECT_FALSE(queue.pop().has_value());
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < PRODUCERS; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < ITEMS; ++i) queue.push({p, i});
+    });
+  }
+  std::vector<int> next(PRODUCERS, 0);
+  int received = 0;
+  while (received < PRODUCERS * ITEMS) {
+    auto item = queue.pop();
+    if (!item) continue;
+    ASSERT_EQ(item->second, next[item->first]++);
+    ++received;
+  }
+  for (auto& producer : producers) producer.join();
+  EXPECT_TRUE(queue.empty());
+
+  // Items left behind are freed with the queue.
+  MpscQueue<std::vector<int>> leftovers;
+  leftovers.push({1, 2, 3});
+  leftovers.push({4});
+  EXPECT_EQ(leftovers.pop()->size(), 3u);
+}
@@ -33,4 +33,44 @@ TEST(PoW, MineAndValidate) {
   c.set_difficulty_bits(12);
   auto vr = c.append_block(mined);
   EXPECT_TRUE(vr.is_valid);
-}
\ No newline at end of file
+}
+TEST(PoW, HeadersValidateWithoutBodies) {
+  ASSERT_TRUE(crypto_init());
+  Chain c(ChainConfig{.difficulty_bits=8});
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+
+  // Mine three blocks on a copy and keep only their headers.
+  Chain ahead = c;
+  auto kp = generate_ec_keypair();
+  std::atomic<bool> cancel{false};
+  std::vector<BlockHeader> headers;
+  for (uint64_t nonce = 1; nonce <= 3; ++nonce) {
+    Transaction tx; tx.version=1; tx.nonce=nonce; tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    auto mined = mine_block(ahead, {tx}, 8, cancel, nullptr, 10'000);
+    ASSERT_TRUE(ahead.append_block(mined).is_valid);
+    headers.push_back(mined.header);
+  }
+
+  c.reset_validation_stats();
+  EXPECT_TRUE(c.validate_header(headers[0]).is_valid);
+  EXPECT_FALSE(c.validate_header(headers[1]).is_valid);  // not on the tip
+  size_t valid = 0;
+  EXPECT_TRUE(c.validate_headers(headers, &valid).is_valid);
+  EXPECT_EQ(valid, 3u);
+  EXPECT_EQ(c.validation_stats().header.runs, 5u);
+  EXPECT_EQ(c.validation_stats().header.rejected, 1u);
+  EXPECT_EQ(c.validation_stats().structure.runs, 0u);
+  EXPECT_EQ(c.validation_stats().signatures.runs, 0u);
+
+  auto bad = headers;
+  do { ++bad[1].nonce; } while (pow::meets_difficulty(8, bad[1].hash()));
+  auto r = c.validate_headers(bad, &valid);
+  EXPECT_EQ(r.error, ValidationError::InsufficientPOW);
+  EXPECT_EQ(valid, 1u);
+
+  bad = headers;
+  bad[2].timestamp = bad[1].timestamp - 1;
+  r = c.validate_headers(bad, &valid);
+  EXPECT_FALSE(r.is_valid);
+  EXPECT_EQ(valid, 2u);
+}
@@ -22,3 +22,20 @@ TEST(Serializer, WriteRaw_NoLengthPrefix) {
   ASSERT_EQ(out.size(), expected.size());
   EXPECT_TRUE(std::equal(out.begin(), out.end(), expected.begin(), expected.end()));
 }
+
+TEST(Serializer, VarintRoundTrip) {
+  ByteWriter writer;
+  const uint64_t values[] = {0, 1, 127, 128, 300, 1700000000ULL, ~0ULL};
+  for (auto v : values) writer.write_varint(v);
+  auto out = writer.take();
+  // 0, 1, 127 -> 1 byte; 128, 300 -> 2; 1700000000 -> 5; 2^64-1 -> 10
+  EXPECT_EQ(out.size(), 3u + 4u + 5u + 10u);
+
+  ByteReader reader(std::span<const uint8_t>(out.data(), out.size()));
+  for (auto v : values) EXPECT_EQ(reader.read_varint(), v);
+  EXPECT_EQ(reader.remaining_bytes(), 0u);
+
+  std::vector<uint8_t> truncated{0x80, 0x80};
+  ByteReader bad(std::span<const uint8_t>(truncated.data(), truncated.size()));
+  EXPECT_THROW(bad.read_varint(), SerializeError);
+}
@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <span>
+#include <stdexcept>
+#include "astro/storage/async_writer.hpp"
 #include "astro/storage/block_store.hpp"
+#include "astro/storage/rocks_block_store.hpp"
+#include "astro/storage/chain_snapshot.hpp"
 #include "astro/core/chain.hpp"
 #include "astro/core/keys.hpp"
 #include "astro/core/hash.hpp"
@@ -16,11 +23,21 @@ static fs::path tmpdir(const char* name) {
   return p;
 }
 
-TEST(Store, AppendRestoreRoundTrip) {
+template <typename StoreT>
+class StoreBackends : public ::testing::Test {};
+
+#ifdef ASTRO_HAVE_ROCKSDB
+using StoreTypes = ::testing::Types<astro::storage::BlockStore, astro::storage::RocksBlockStore>;
+#else
+using StoreTypes = ::testing::Types<astro::storage::BlockStore>;
+#endif
+TYPED_TEST_SUITE(StoreBackends, StoreTypes);
+
+TYPED_TEST(StoreBackends, AppendRestoreRoundTrip) {
   ASSERT_TRUE(crypto_init());
   Chain c(ChainConfig{.difficulty_bits=0});
   auto dir = tmpdir("store");
-  astro::storage::BlockStore store(dir);
+  TypeParam store(dir);
 
   // genesis
   auto g = make_genesis_block("g", 1700000000ULL);
@@ -41,4 +58,855 @@ TEST(Store, AppendRestoreRoundTrip) {
   ASSERT_TRUE(tip1.has_value() && tip2.has_value());
   EXPECT_EQ(to_hex(std::span<const uint8_t>(tip1->data(), tip1->size())).substr(0,16),
             to_hex(std::span<const uint8_t>(tip2->data(), tip2->size())).substr(0,16));
-}
\ No newline at end of file
+
+  store.clear();
+  EXPECT_EQ(store.record_count(), 0u);
+  EXPECT_TRUE(store.load_all_blocks().empty());
+}
+
+#ifdef ASTRO_HAVE_ROCKSDB
+TEST(Store, RocksIndexesLookUpBlocksAndTransactions) {
+  ASSERT_TRUE(crypto_init());
+  Chain c(ChainConfig{.difficulty_bits=0});
+  auto dir = tmpdir("store_rocks_idx");
+  {
+    astro::storage::RocksBlockStore store(dir);
+    ASSERT_TRUE(c.append_and_store(make_genesis_block("g", 1700000000ULL), store).is_valid);
+    auto kp = generate_ec_keypair();
+    Transaction tx; tx.version=1; tx.nonce=1; tx.amount=7; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    ASSERT_TRUE(c.append_and_store(c.build_block_from_transactions({tx}, 1700000001ULL), store).is_valid);
+  }
+  astro::storage::RocksBlockStore reopened(dir);
+  EXPECT_EQ(reopened.record_count(), 2u);
+  auto tip = c.tip_hash();
+  ASSERT_TRUE(tip.has_value());
+  EXPECT_EQ(reopened.height_of(*tip), std::optional<uint64_t>(1));
+  auto block = reopened.read_block(1);
+  ASSERT_TRUE(block.has_value());
+  auto location = reopened.find_transaction(block->transactions.back().tx_hash());
+  ASSERT_TRUE(location.has_value());
+  EXPECT_EQ(location->height, 1u);
+  EXPECT_EQ(location->index, block->transactions.size() - 1);
+  EXPECT_FALSE(reopened.read_block(2).has_value());
+}
+#endif
+
+static void append_chain(Chain& c, astro::storage::BlockStore& store, size_t count) {
+  auto kp = generate_ec_keypair();
+  if (c.height() == 0) {
+    ASSERT_TRUE(c.append_and_store(make_genesis_block("g", 1700000000ULL), store).is_valid);
+  }
+  while (c.height() < count) {
+    Transaction tx; tx.version=1; tx.nonce=c.height(); tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+    auto b = c.build_block_from_transactions({tx}, 1700000000ULL + c.height());
+    ASSERT_TRUE(c.append_and_store(b, store).is_valid);
+  }
+}
+
+TEST(Store, TornTailIsTruncatedOnOpen) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_torn");
+  uint64_t good_size = 0;
+  {
+    astro::storage::BlockStore store(dir);
+    Chain c;
+    append_chain(c, store, 3);
+    good_size = store.data_size();
+  }
+  const std::string junk = "ASTR-partial-record";
+  {
+    // Simulate a crash mid-append: a partial record after the good ones.
+    std::fstream out(dir / "chain.log", std::ios::binary | std::ios::in | std::ios::out);
+    out.seekp(static_cast<std::streamoff>(good_size));
+    out.write(junk.data(), static_cast<std::streamsize>(junk.size()));
+  }
+
+  astro::storage::BlockStore store(dir);
+  EXPECT_EQ(store.recovery().records, 3u);
+  EXPECT_EQ(store.recovery().discarded_bytes, junk.size());
+  EXPECT_FALSE(store.recovery().index_rebuilt);
+  EXPECT_LE(store.recovery().scanned_records, 1u);
+  EXPECT_EQ(fs::file_size(store.log_path()), good_size);
+
+  // Appends after recovery must be reachable on the next open.
+  Chain c;
+  c.restore_from_store(store);
+  ASSERT_EQ(c.height(), 3u);
+  append_chain(c, store, 4);
+
+  astro::storage::BlockStore reopened(dir);
+  Chain c2;
+  c2.restore_from_store(reopened);
+  EXPECT_EQ(c2.height(), 4u);
+}
+
+TEST(Store, CorruptRecordMidLogThrowsOnLoad) {
+  ASSERT_TRUE(crypto_init());
+  for (bool use_io_uring : {false, true}) {
+    auto dir = tmpdir("store_corrupt_mid");
+    uint64_t third_start = 0, third_end = 0;
+    {
+      astro::storage::BlockStore store(dir, {.use_io_uring = use_io_uring});
+      Chain c;
+      append_chain(c, store, 2);
+      third_start = store.data_size();
+      append_chain(c, store, 3);
+      third_end = store.data_size();
+      append_chain(c, store, 5);
+    }
+    {
+      // Recovery trusts the checkpointed index, so this is only seen on load.
+      const auto at = static_cast<std::streamoff>((third_start + third_end) / 2);
+      std::fstream f(dir / "chain.log", std::ios::binary | std::ios::in | std::ios::out);
+      f.seekg(at);
+      char b = 0; f.read(&b, 1); b ^= 0x40;
+      f.seekp(at);
+      f.write(&b, 1);
+    }
+
+    astro::storage::BlockStore store(dir, {.use_io_uring = use_io_uring});
+    ASSERT_EQ(store.recovery().records, 5u);
+    size_t loaded = 0;
+    EXPECT_THROW(store.load_blocks([&](Block&&) { return ++loaded, true; }), std::runtime_error);
+    EXPECT_EQ(loaded, 2u);
+
+    Chain c;
+    EXPECT_THROW(c.restore_from_store(store), std::runtime_error);
+    EXPECT_EQ(c.height(), 2u);
+  }
+}
+
+TEST(Store, CorruptRecordMidLogIsNotTakenForATornTail) {
+  ASSERT_TRUE(crypto_init());
+  for (bool use_io_uring : {false, true}) {
+    auto dir = tmpdir("store_corrupt_rebuild");
+    uint64_t third_start = 0, third_end = 0;
+    {
+      astro::storage::BlockStore store(dir, {.use_io_uring = use_io_uring});
+      Chain c;
+      append_chain(c, store, 2);
+      third_start = store.data_size();
+      append_chain(c, store, 3);
+      third_end = store.data_size();
+      append_chain(c, store, 5);
+    }
+    fs::remove(dir / "chain.idx");  // the rebuild scan meets the bad record
+    {
+      const auto at = static_cast<std::streamoff>((third_start + third_end) / 2);
+      std::fstream f(dir / "chain.log", std::ios::binary | std::ios::in | std::ios::out);
+      f.seekg(at);
+      char b = 0; f.read(&b, 1); b ^= 0x40;
+      f.seekp(at);
+      f.write(&b, 1);
+    }
+    const auto size = fs::file_size(dir / "chain.log");
+    EXPECT_THROW(astro::storage::BlockStore(dir, {.use_io_uring = use_io_uring}), std::runtime_error);
+    EXPECT_EQ(fs::file_size(dir / "chain.log"), size);
+  }
+}
+
+TEST(Store, MissingIndexIsRebuilt) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_noidx");
+  {
+    astro::storage::BlockStore store(dir);
+    Chain c;
+    append_chain(c, store, 3);
+  }
+  fs::remove(dir / "chain.idx");
+
+  astro::storage::BlockStore store(dir);
+  EXPECT_TRUE(store.recovery().index_rebuilt);
+  EXPECT_EQ(store.recovery().records, 3u);
+  EXPECT_EQ(store.recovery().discarded_bytes, 0u);
+  EXPECT_EQ(fs::file_size(dir / "chain.idx"), 3 * sizeof(uint64_t));
+}
+
+TEST(Store, Crc32cRecordsRoundTripAlongsideSha256) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_crc");
+  Chain c;
+  {
+    astro::storage::BlockStore v1(dir);
+    append_chain(c, v1, 2);
+  }
+  uint64_t v1_size = 0, v2_size = 0;
+  {
+    astro::storage::BlockStore v2(dir, {.checksum = astro::storage::RecordChecksum::Crc32c});
+    EXPECT_EQ(v2.recovery().records, 2u);
+    v1_size = v2.data_size();
+    append_chain(c, v2, 4);
+    v2_size = v2.data_size();
+  }
+
+  // Flip one payload byte in the last (v2) record: it must be caught and dropped.
+  {
+    std::fstream f(dir / "chain.log", std::ios::binary | std::ios::in | std::ios::out);
+    f.seekg(static_cast<std::streamoff>(v2_size - 10));
+    char b = 0; f.read(&b, 1); b ^= 0x40;
+    f.seekp(static_cast<std::streamoff>(v2_size - 10));
+    f.write(&b, 1);
+  }
+  astro::storage::BlockStore store(dir);
+  EXPECT_EQ(store.recovery().records, 3u);
+  EXPECT_GT(store.data_size(), v1_size);
+
+  Chain c2;
+  c2.restore_from_store(store);
+  EXPECT_EQ(c2.height(), 3u);
+  EXPECT_EQ(c2.block_at(2)->header.hash(), c.block_at(2)->header.hash());
+}
+
+TEST(Store, IoBackendsReadEachOthersLogs) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_io_backends");
+  Chain c;
+  {
+    astro::storage::BlockStore ring(dir, {.use_io_uring = true});
+    append_chain(c, ring, 3);
+  }
+  {
+    astro::storage::BlockStore blocking(dir, {.use_io_uring = false});
+    EXPECT_FALSE(blocking.io_uring_active());
+    EXPECT_EQ(blocking.load_all_blocks().size(), 3u);
+    append_chain(c, blocking, 5);
+  }
+  fs::remove(dir / "chain.idx"); // force the full-scan rebuild path
+  astro::storage::BlockStore ring(dir, {.use_io_uring = true});
+  EXPECT_TRUE(ring.recovery().index_rebuilt);
+  auto blocks = ring.load_all_blocks();
+  ASSERT_EQ(blocks.size(), 5u);
+  EXPECT_EQ(blocks.back().header.hash(), *c.tip_hash());
+}
+
+TEST(Store, PreallocatedTailIsFreeSpace) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_prealloc");
+  Chain c;
+  uint64_t data_size = 0;
+  {
+    astro::storage::BlockStore store(dir, {.preallocate_bytes = 64 * 1024});
+    append_chain(c, store, 3);
+    data_size = store.data_size();
+    EXPECT_EQ(store.allocated_size(), 64u * 1024);
+  }
+  EXPECT_EQ(fs::file_size(dir / "chain.log"), 64u * 1024);
+
+  {
+    astro::storage::BlockStore store(dir, {.preallocate_bytes = 64 * 1024});
+    EXPECT_EQ(store.recovery().records, 3u);
+    EXPECT_EQ(store.recovery().discarded_bytes, 0u);
+    EXPECT_EQ(store.recovery().preallocated_bytes, 64u * 1024 - data_size);
+    EXPECT_LE(store.recovery().scanned_records, 1u);
+    Chain restored;
+    restored.restore_from_store(store);
+    append_chain(restored, store, 5);
+  }
+
+  // A store without preallocation reads and extends the same log.
+  astro::storage::BlockStore plain(dir, {.preallocate_bytes = 0});
+  EXPECT_EQ(plain.recovery().records, 5u);
+  Chain restored;
+  restored.restore_from_store(plain);
+  append_chain(restored, plain, 6);
+  EXPECT_EQ(plain.load_all_blocks().size(), 6u);
+}
+
+TEST(Store, CompactHeadersRebuildPrevHash) {
+  ASSERT_TRUE(crypto_init());
+  auto full_dir = tmpdir("store_full_headers");
+  auto compact_dir = tmpdir("store_compact_headers");
+  const astro::storage::BlockStoreOptions compact{.compact_headers = true};
+  Chain c;
+  {
+    astro::storage::BlockStore full(full_dir);
+    append_chain(c, full, 4);
+  }
+  astro::storage::BlockStore full(full_dir);
+  {
+    astro::storage::BlockStore store(compact_dir, compact);
+    store.append_blocks(full.load_all_blocks());
+    // Only the genesis record keeps its prev_hash.
+    EXPECT_LT(store.data_size() + 3 * 40, full.data_size());
+  }
+  {
+    // Reopened, the first append is written in full, the rest linked again.
+    astro::storage::BlockStore store(compact_dir, compact);
+    Chain restored;
+    restored.restore_from_store(store);
+    ASSERT_EQ(restored.height(), 4u);
+    append_chain(restored, store, 6);
+  }
+
+  astro::storage::BlockStore store(compact_dir, compact);
+  auto blocks = store.load_all_blocks();
+  ASSERT_EQ(blocks.size(), 6u);
+  for (size_t i = 1; i < blocks.size(); ++i) {
+    EXPECT_EQ(blocks[i].header.prev_hash, blocks[i - 1].header.hash());
+  }
+  auto originals = full.load_all_blocks();
+  for (size_t i = 0; i < originals.size(); ++i) {
+    EXPECT_EQ(blocks[i].header.hash(), originals[i].header.hash());
+  }
+}
+
+TEST(Store, KeyDictionaryKeepsTransactionsIdentical) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_keydict");
+  auto plain_dir = tmpdir("store_keydict_plain");
+  const astro::storage::BlockStoreOptions dict{.key_dictionary = true};
+
+  // Two senders alternating over a few blocks of several txs each.
+  KeyPair senders[] = {generate_ec_keypair(), generate_ec_keypair()};
+  Chain c;
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  for (uint64_t h = 1; h < 4; ++h) {
+    std::vector<Transaction> txs;
+    for (uint64_t i = 0; i < 4; ++i) {
+      const auto& kp = senders[(h + i) % 2];
+      Transaction tx; tx.version=1; tx.nonce=h * 4 + i; tx.amount=i; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="to-" + std::to_string(i); tx.sign(kp.privkey_pem);
+      txs.push_back(std::move(tx));
+    }
+    ASSERT_TRUE(c.append_block(c.build_block_from_transactions(std::move(txs), 1700000000ULL + h)).is_valid);
+  }
+  std::vector<Block> blocks;
+  for (uint64_t h = 0; h < c.height(); ++h) blocks.push_back(*c.block_at(h));
+
+  uint64_t plain_size = 0;
+  {
+    astro::storage::BlockStore plain(plain_dir);
+    plain.append_blocks(blocks);
+    plain_size = plain.data_size();
+  }
+  {
+    astro::storage::BlockStore store(dir, dict);
+    store.append_blocks(std::span<const Block>(blocks).first(2));
+    store.append_blocks(std::span<const Block>(blocks).subspan(2));
+    EXPECT_EQ(store.key_count(), 2u);
+    EXPECT_LT(store.data_size() * 2, plain_size);
+  }
+
+  astro::storage::BlockStore store(dir, dict);
+  EXPECT_EQ(store.key_count(), 2u);
+  auto loaded = store.load_all_blocks();
+  ASSERT_EQ(loaded.size(), blocks.size());
+  for (size_t h = 0; h < blocks.size(); ++h) {
+    EXPECT_EQ(loaded[h].serialize(), blocks[h].serialize());
+  }
+  EXPECT_TRUE(loaded.back().transactions.back().verify());
+
+  // Known senders don't grow the dictionary; a torn dictionary tail is dropped.
+  Chain restored;
+  restored.restore_from_store(store);
+  ASSERT_EQ(restored.height(), blocks.size());
+  Transaction tx; tx.version=1; tx.nonce=99; tx.amount=1; tx.from_pub_pem=senders[0].pubkey_pem; tx.to_label="x"; tx.sign(senders[0].privkey_pem);
+  ASSERT_TRUE(restored.append_and_store(restored.build_block_from_transactions({tx}, 1700000010ULL), store).is_valid);
+  EXPECT_EQ(store.key_count(), 2u);
+  {
+    std::ofstream out(dir / "keys.dict", std::ios::binary | std::ios::app);
+    out.write("\x40\x00\x00\x00partial", 11);
+  }
+  astro::storage::BlockStore reopened(dir, dict);
+  EXPECT_EQ(reopened.key_count(), 2u);
+  EXPECT_EQ(reopened.load_all_blocks().size(), blocks.size() + 1);
+}
+
+TEST(Store, CompressedRecordsRoundTrip) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_lz4");
+  auto plain_dir = tmpdir("store_lz4_plain");
+  const astro::storage::BlockStoreOptions lz4{.compression = astro::storage::Compression::Lz4};
+
+  auto kp = generate_ec_keypair();
+  Chain c;
+  ASSERT_TRUE(c.append_block(make_genesis_block("g", 1700000000ULL)).is_valid);
+  for (uint64_t h = 1; h < 4; ++h) {
+    std::vector<Transaction> txs;
+    for (uint64_t i = 0; i < 6; ++i) {
+      Transaction tx; tx.version=1; tx.nonce=h * 6 + i; tx.amount=i; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="to"; tx.sign(kp.privkey_pem);
+      txs.push_back(std::move(tx));
+    }
+    ASSERT_TRUE(c.append_block(c.build_block_from_transactions(std::move(txs), 1700000000ULL + h)).is_valid);
+  }
+  std::vector<Block> blocks;
+  for (uint64_t h = 0; h < c.height(); ++h) blocks.push_back(*c.block_at(h));
+
+  astro::storage::BlockStore plain(plain_dir);
+  plain.append_blocks(blocks);
+  {
+    astro::storage::BlockStore store(dir, lz4);
+    store.append_blocks(blocks);
+    EXPECT_LT(store.data_size() * 2, plain.data_size());
+  }
+
+  // Any store can read compressed records; the tiny genesis record stays raw.
+  astro::storage::BlockStore store(dir);
+  auto loaded = store.load_all_blocks();
+  ASSERT_EQ(loaded.size(), blocks.size());
+  for (size_t h = 0; h < blocks.size(); ++h) EXPECT_EQ(loaded[h].serialize(), blocks[h].serialize());
+}
+
+TEST(Store, PruneBodiesCompactsLogAndRestores) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_prune");
+  const astro::storage::BlockStoreOptions options{.preallocate_bytes = 0, .prune_compact_bytes = 1};
+  Chain full;
+  uint64_t full_size = 0;
+  {
+    astro::storage::BlockStore store(dir, options);
+    append_chain(full, store, 10);
+    full_size = store.data_size();
+  }
+
+  {
+    astro::storage::BlockStore store(dir, options);
+    Chain c(ChainConfig{.keep_recent_bodies = 4});
+    c.restore_from_store(store);
+    ASSERT_EQ(c.height(), 10u);
+    EXPECT_EQ(c.pruned_height(), 6u);
+    store.prune_bodies(c.pruned_height());
+    EXPECT_EQ(store.pruned_height(), 6u);
+    EXPECT_LT(store.data_size(), full_size);
+    EXPECT_EQ(fs::file_size(store.log_path()), store.data_size());
+
+    // Appending through the pruning chain keeps the store in step.
+    append_chain(c, store, 11);
+    EXPECT_EQ(store.pruned_height(), 7u);
+  }
+
+  astro::storage::BlockStore store(dir, options);
+  EXPECT_EQ(store.pruned_height(), 7u);
+  EXPECT_FALSE(store.recovery().index_rebuilt);
+  Chain c;
+  c.restore_from_store(store);
+  ASSERT_EQ(c.height(), 11u);
+  EXPECT_EQ(c.pruned_height(), 7u);
+  EXPECT_EQ(c.block_at(9)->header.hash(), full.block_at(9)->header.hash());
+  EXPECT_FALSE(c.block_at(10)->transactions.empty());
+}
+
+// A valid chain of `count` blocks except for one broken signature at `bad`,
+// relinked so the signature is the only thing wrong with it.
+static std::vector<Block> chain_with_bad_signature(size_t count, size_t bad) {
+  Chain source;
+  astro::storage::BlockStore scratch(tmpdir("store_bad_signature_src"));
+  append_chain(source, scratch, count);
+  auto blocks = source.blocks();
+  blocks[bad].transactions[0].signature[4] ^= 0x01;
+  blocks[bad].header.merkle_root = compute_merkle_root(blocks[bad].transactions);
+  for (size_t h = bad + 1; h < blocks.size(); ++h) blocks[h].header.prev_hash = blocks[h - 1].header.hash();
+  return blocks;
+}
+
+struct UnprunableStore : astro::storage::BlockStore {
+  using BlockStore::BlockStore;
+  void prune_bodies(uint64_t) override { throw std::runtime_error("disk full"); }
+};
+
+TEST(Store, FailedPruneDoesNotFailTheAppend) {
+  ASSERT_TRUE(crypto_init());
+  UnprunableStore store(tmpdir("store_prune_fails"));
+  Chain c(ChainConfig{.keep_recent_bodies = 2});
+  append_chain(c, store, 6);
+  EXPECT_EQ(c.height(), 6u);
+  EXPECT_EQ(store.record_count(), 6u);
+  EXPECT_EQ(store.pruned_height(), 0u);
+}
+
+TEST(Store, ParallelRestoreStopsAtFirstBadSignature) {
+  ASSERT_TRUE(crypto_init());
+  auto blocks = chain_with_bad_signature(100, 70);
+  astro::storage::BlockStore store(tmpdir("store_parallel_restore"));
+  store.append_blocks(blocks);
+  for (size_t threads : {1, 3, 8}) {
+    Chain c(ChainConfig{.restore_threads = threads});
+    c.restore_from_store(store);
+    ASSERT_EQ(c.height(), 70u) << threads << " threads";
+    EXPECT_EQ(c.tip_hash(), blocks[69].header.hash());
+  }
+}
+
+TEST(Store, RestoreStopsAtUnparsableSenderKey) {
+  ASSERT_TRUE(crypto_init());
+  auto blocks = chain_with_bad_signature(40, 30);
+  blocks[30].transactions[0].from_pub_pem.assign(64, 'x');
+  blocks[30].header.merkle_root = compute_merkle_root(blocks[30].transactions);
+  for (size_t h = 31; h < blocks.size(); ++h) blocks[h].header.prev_hash = blocks[h - 1].header.hash();
+  astro::storage::BlockStore store(tmpdir("store_garbage_key"));
+  store.append_blocks(blocks);
+  for (size_t threads : {1, 4}) {
+    Chain c(ChainConfig{.restore_threads = threads});
+    c.restore_from_store(store);
+    ASSERT_EQ(c.height(), 30u) << threads << " threads";
+  }
+}
+
+// Throws from load_blocks once `fail_after` blocks have been handed out.
+struct FailingReadStore : astro::storage::BlockStore {
+  using BlockStore::BlockStore;
+  size_t fail_after = ~size_t{0};
+  void load_blocks(const std::function<bool(Block&&)>& sink) override {
+    size_t sent = 0;
+    BlockStore::load_blocks([&](Block&& block) {
+      if (sent++ == fail_after) throw std::runtime_error("read failed");
+      return sink(std::move(block));
+    });
+  }
+};
+
+TEST(Store, FailedReadLeavesNoUncheckedBlocksOrStaleLedger) {
+  ASSERT_TRUE(crypto_init());
+  {
+    // The checkpoint is never reached, so the skipped signatures are
+    // checked after all and the broken one at 20 ends the chain.
+    auto blocks = chain_with_bad_signature(60, 20);
+    FailingReadStore store(tmpdir("store_read_fails_unconfirmed"));
+    store.append_blocks(blocks);
+    store.fail_after = 40;
+    Chain c(ChainConfig{.restore_threads = 2, .assume_valid_hash = blocks[50].header.hash()});
+    EXPECT_THROW(c.restore_from_store(store), std::runtime_error);
+    EXPECT_EQ(c.height(), 20u);
+  }
+  {
+    // A snapshot's ledger reaches past where the read fails.
+    const ChainConfig config{.restore_threads = 2, .track_ledger = true};
+    Chain source(config);
+    FailingReadStore store(tmpdir("store_read_fails_ledger"));
+    append_chain(source, store, 20);
+    const auto snapshot = source.snapshot();
+    store.fail_after = 10;
+    Chain c(config);
+    EXPECT_THROW(c.restore_from_store(store, &snapshot), std::runtime_error);
+    ASSERT_EQ(c.height(), 10u);
+    EXPECT_EQ(c.ledger()->received("x"), 9u);
+  }
+}
+
+TEST(Store, AssumeValidSkipsSignaturesBelowCheckpoint) {
+  ASSERT_TRUE(crypto_init());
+  auto blocks = chain_with_bad_signature(100, 20);
+  astro::storage::BlockStore store(tmpdir("store_assume_valid"));
+  store.append_blocks(blocks);
+  const Hash256 checkpoint = blocks[50].header.hash();
+  auto restored_height = [&](ChainConfig config) {
+    config.restore_threads = 2;
+    Chain c(config);
+    c.restore_from_store(store);
+    // A redone restore must not leave index entries from the first attempt.
+    EXPECT_EQ(c.find_by_hash(blocks[c.height() - 1].header.hash()), c.height() - 1);
+    if (c.height() < blocks.size()) {
+      EXPECT_FALSE(c.find_by_hash(blocks[c.height()].header.hash()).has_value());
+    }
+    return c.height();
+  };
+
+  // The broken signature sits below the checkpoint, so it isn't looked at.
+  EXPECT_EQ(restored_height({.assume_valid_height = 50}), 100u);
+  EXPECT_EQ(restored_height({.assume_valid_height = 50, .assume_valid_hash = checkpoint}), 100u);
+  EXPECT_EQ(restored_height({.assume_valid_hash = checkpoint}), 100u);
+
+  // Checkpoint below the bad block, forced full checks, or a checkpoint that
+  // isn't on this chain: signatures are verified and restore stops there.
+  EXPECT_EQ(restored_height({.assume_valid_height = 10}), 20u);
+  EXPECT_EQ(restored_height({.assume_valid_height = 50, .force_full_verification = true}), 20u);
+  EXPECT_EQ(restored_height({.assume_valid_height = 49, .assume_valid_hash = checkpoint}), 20u);
+  EXPECT_EQ(restored_height({.assume_valid_hash = blocks[50].header.merkle_root}), 20u);
+}
+
+TEST(Store, ChainSnapshotRoundTripsAndRejectsCorruption) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_snapshot_file");
+  Chain c;
+  astro::storage::BlockStore store(dir);
+  append_chain(c, store, 5);
+  auto snapshot = c.snapshot();
+  ASSERT_EQ(snapshot.hashes.size(), 5u);
+  EXPECT_EQ(snapshot.hashes.back(), c.tip_hash());
+
+  const auto path = dir / "chain.snap";
+  EXPECT_FALSE(astro::storage::read_chain_snapshot(path).has_value());
+  astro::storage::write_chain_snapshot(path, snapshot);
+  auto loaded = astro::storage::read_chain_snapshot(path);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->headers, snapshot.headers);
+  EXPECT_EQ(loaded->hashes, snapshot.hashes);
+  EXPECT_FALSE(fs::exists(dir / "chain.snap.tmp"));
+
+  {
+    std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+    out.seekp(40);
+    out.put('\x7f');
+  }
+  EXPECT_FALSE(astro::storage::read_chain_snapshot(path).has_value());
+
+  {
+    astro::storage::SnapshotWriter writer(path);
+    writer.submit(snapshot);
+    writer.flush();
+    EXPECT_EQ(writer.writes(), 1u);
+    append_chain(c, store, 6);
+    writer.submit(c.snapshot());
+  }
+  loaded = astro::storage::read_chain_snapshot(path);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->hashes.size(), 6u);
+
+  // From a view, built on the writer thread while the chain moves on.
+  {
+    astro::storage::SnapshotWriter writer(path);
+    append_chain(c, store, 8);
+    auto view = c.view();
+    append_chain(c, store, 9);
+    writer.submit(view, Ledger{});
+  }
+  loaded = astro::storage::read_chain_snapshot(path);
+  ASSERT_TRUE(loaded.has_value());
+  snapshot = c.snapshot();
+  EXPECT_EQ(loaded->headers, std::vector<BlockHeader>(snapshot.headers.begin(), snapshot.headers.begin() + 8));
+  EXPECT_EQ(loaded->hashes, std::vector<Hash256>(snapshot.hashes.begin(), snapshot.hashes.begin() + 8));
+  EXPECT_TRUE(loaded->ledger.has_value());
+}
+
+TEST(Store, RestoreTrustsOnlyBlocksMatchingSnapshot) {
+  ASSERT_TRUE(crypto_init());
+  auto blocks = chain_with_bad_signature(40, 10);
+  astro::storage::BlockStore store(tmpdir("store_snapshot_restore"));
+  store.append_blocks(blocks);
+  auto snapshot_of = [&](size_t count) {
+    ChainSnapshot snapshot;
+    for (size_t h = 0; h < count; ++h) {
+      snapshot.headers.push_back(blocks[h].header);
+      snapshot.hashes.push_back(blocks[h].header.hash());
+    }
+    return snapshot;
+  };
+  auto restored_height = [&](const ChainSnapshot* snapshot) {
+    Chain c(ChainConfig{.restore_threads = 2});
+    c.restore_from_store(store, snapshot);
+    EXPECT_EQ(c.tip_hash(), blocks[c.height() - 1].header.hash());
+    return c.height();
+  };
+
+  EXPECT_EQ(restored_height(nullptr), 10u);
+  // Blocks the snapshot covers were validated when it was taken.
+  auto covering = snapshot_of(30);
+  EXPECT_EQ(restored_height(&covering), 40u);
+  // Blocks past it get full checks.
+  auto short_snapshot = snapshot_of(5);
+  EXPECT_EQ(restored_height(&short_snapshot), 10u);
+
+  // A snapshot of some other chain vouches for nothing in this one.
+  Chain other;
+  astro::storage::BlockStore other_store(tmpdir("store_snapshot_other"));
+  append_chain(other, other_store, 30);
+  auto foreign = other.snapshot();
+  EXPECT_EQ(restored_height(&foreign), 10u);
+}
+
+TEST(Store, AppendBlocksKeepsValidPrefix) {
+  ASSERT_TRUE(crypto_init());
+  auto blocks = chain_with_bad_signature(12, 7);
+  astro::storage::BlockStore store(tmpdir("store_append_blocks"));
+  Chain c;
+  auto result = c.append_blocks(std::span<const Block>(blocks).first(3), store);
+  EXPECT_EQ(result.appended, 3u);
+  EXPECT_TRUE(result.validation.is_valid);
+
+  result = c.append_blocks(std::span<const Block>(blocks).subspan(3), store);
+  EXPECT_EQ(result.appended, 4u);
+  EXPECT_FALSE(result.validation.is_valid);
+  EXPECT_EQ(result.validation.error, ValidationError::BadTransactionSignature);
+  EXPECT_EQ(c.height(), 7u);
+  EXPECT_EQ(store.record_count(), 7u);
+
+  Chain restored;
+  restored.restore_from_store(store);
+  EXPECT_EQ(restored.height(), 7u);
+  EXPECT_EQ(restored.tip_hash(), c.tip_hash());
+}
+
+TEST(Store, ReadBodyUsesIndexForEveryRecordFormat) {
+  ASSERT_TRUE(crypto_init());
+  Chain source;
+  {
+    astro::storage::BlockStore scratch(tmpdir("store_read_body_src"));
+    append_chain(source, scratch, 6);
+  }
+  const astro::storage::BlockStoreOptions variants[] = {
+    {},
+    {.compact_headers = true, .key_dictionary = true},
+    {.compact_headers = true, .compression = astro::storage::Compression::Lz4, .compress_min_bytes = 0},
+  };
+  for (const auto& options : variants) {
+    astro::storage::BlockStore store(tmpdir("store_read_body"), options);
+    store.append_blocks(source.blocks());
+    for (uint64_t h = 0; h < source.height(); ++h) {
+      Block block{source.block_at(h)->header, store.read_body(h)};
+      EXPECT_EQ(block.serialize(), source.block_at(h)->serialize()) << h;
+    }
+    EXPECT_THROW(store.read_body(source.height()), std::out_of_range);
+  }
+}
+
+TEST(Store, PagedChainKeepsHeadersAndPagesBodies) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_paged");
+  Chain full;
+  {
+    astro::storage::BlockStore store(dir);
+    append_chain(full, store, 20);
+  }
+
+  astro::storage::BlockStore store(dir);
+  Chain paged(ChainConfig{.body_cache_blocks = 4}, store);
+  paged.restore_from_store(store);
+  ASSERT_EQ(paged.height(), 20u);
+  EXPECT_EQ(paged.pruned_height(), 19u);
+  EXPECT_LT(paged.retained_body_bytes(), full.retained_body_bytes() / 10);
+
+  auto early = paged.get_block(2);
+  ASSERT_TRUE(early);
+  for (size_t h = 0; h < paged.height(); ++h) {
+    EXPECT_EQ(paged.get_block(h)->serialize(), full.block_at(h)->serialize()) << h;
+  }
+  EXPECT_EQ(paged.get_block(20), nullptr);
+
+  // Appends neither invalidate handles nor make the store drop bodies.
+  append_chain(paged, store, 25);
+  EXPECT_EQ(early->serialize(), full.block_at(2)->serialize());
+  EXPECT_EQ(store.pruned_height(), 0u);
+  EXPECT_FALSE(paged.get_block(21)->transactions.empty());
+}
+
+// Holds every write until `release` is set.
+struct StalledStore : astro::storage::BlockStore {
+  using BlockStore::BlockStore;
+  std::shared_future<void> release;
+  void append_blocks(std::span<const Block> blocks) override {
+    release.wait();
+    BlockStore::append_blocks(blocks);
+  }
+};
+
+TEST(Store, PagedChainKeepsBodiesUntilTheyAreDurable) {
+  ASSERT_TRUE(crypto_init());
+  std::promise<void> release;
+  StalledStore store(tmpdir("store_paged_async"));
+  store.release = release.get_future().share();
+  Chain paged(ChainConfig{.body_cache_blocks = 1}, store);
+  std::vector<std::future<void>> durable;
+  {
+    astro::storage::AsyncBlockWriter writer(store);
+    auto kp = generate_ec_keypair();
+    ASSERT_TRUE(paged.append_and_store_async(make_genesis_block("g", 1700000000ULL), writer).validation.is_valid);
+    while (paged.height() < 8) {
+      Transaction tx; tx.version=1; tx.nonce=paged.height(); tx.amount=1; tx.from_pub_pem=kp.pubkey_pem; tx.to_label="x"; tx.sign(kp.privkey_pem);
+      auto result = paged.append_and_store_async(paged.build_block_from_transactions({tx}, 1700000000ULL + paged.height()), writer);
+      ASSERT_TRUE(result.validation.is_valid);
+      durable.push_back(std::move(result.durable));
+    }
+    // Nothing is in the store yet, and the cache holds one body.
+    EXPECT_EQ(store.record_count(), 0u);
+    for (size_t h = 1; h < paged.height(); ++h) EXPECT_EQ(paged.get_block(h)->transactions.size(), 1u) << h;
+
+    release.set_value();
+    writer.flush();
+  }
+  for (auto& future : durable) future.get();
+  paged.mark_durable(paged.height());
+  ASSERT_EQ(store.record_count(), 8u);
+  for (size_t h = 1; h < paged.height(); ++h) EXPECT_EQ(paged.get_block(h)->transactions.size(), 1u) << h;
+}
+
+TEST(Store, TxIndexIsRebuiltOnRestoreAndCarriedBySnapshot) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_tx_index");
+  const ChainConfig config{.restore_threads = 2, .index_transactions = true};
+  Chain source(config);
+  astro::storage::BlockStore store(dir);
+  append_chain(source, store, 30);
+  auto expect_indexed = [&](const Chain& c) {
+    for (size_t h = 0; h < source.height(); ++h) {
+      const auto& block = *source.block_at(h);
+      auto found = c.find_transaction(block.transactions[0].tx_hash());
+      ASSERT_TRUE(found.has_value()) << h;
+      EXPECT_EQ(found->height, h);
+      EXPECT_EQ(found->index, 0u);
+      ASSERT_TRUE(found->proof.has_value());
+      EXPECT_TRUE(verify_proof(block.transactions[0].tx_hash(), *found->proof, block.header.merkle_root));
+    }
+  };
+
+  Chain rebuilt(config);
+  rebuilt.restore_from_store(store);
+  expect_indexed(rebuilt);
+
+  const auto path = dir / "chain.snap";
+  astro::storage::write_chain_snapshot(path, source.snapshot());
+  auto loaded = astro::storage::read_chain_snapshot(path);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_TRUE(loaded->has_tx_index);
+  EXPECT_EQ(loaded->transactions.size(), 30u);
+  Chain from_snapshot(config);
+  from_snapshot.restore_from_store(store, &*loaded);
+  expect_indexed(from_snapshot);
+
+  // A snapshot without the index still restores one.
+  Chain plain;
+  plain.restore_from_store(store);
+  EXPECT_FALSE(plain.snapshot().has_tx_index);
+  auto unindexed = plain.snapshot();
+  Chain from_plain(config);
+  from_plain.restore_from_store(store, &unindexed);
+  expect_indexed(from_plain);
+}
+
+TEST(Store, LedgerComesFromSnapshotOrIsRebuilt) {
+  ASSERT_TRUE(crypto_init());
+  auto dir = tmpdir("store_ledger");
+  const ChainConfig config{.restore_threads = 2, .track_ledger = true};
+  Chain source(config);
+  astro::storage::BlockStore store(dir);
+  append_chain(source, store, 20);
+  ASSERT_EQ(source.ledger()->sender_count(), 1u);
+  EXPECT_EQ(source.ledger()->received("x"), 19u);
+
+  Chain rebuilt(config);
+  rebuilt.restore_from_store(store);
+  EXPECT_EQ(*rebuilt.ledger(), *source.ledger());
+
+  const auto path = dir / "chain.snap";
+  astro::storage::write_chain_snapshot(path, source.snapshot());
+  auto loaded = astro::storage::read_chain_snapshot(path);
+  ASSERT_TRUE(loaded.has_value() && loaded->ledger.has_value());
+  EXPECT_EQ(*loaded->ledger, *source.ledger());
+  Chain from_snapshot(config);
+  from_snapshot.restore_from_store(store, &*loaded);
+  EXPECT_EQ(*from_snapshot.ledger(), *source.ledger());
+
+  // A snapshot that ran ahead of the log can't stand for it.
+  auto ahead_dir = tmpdir("store_ledger_ahead");
+  fs::copy(dir / "chain.log", ahead_dir / "chain.log");
+  Chain extended(config);
+  astro::storage::BlockStore ahead_store(ahead_dir);
+  extended.restore_from_store(ahead_store);
+  append_chain(extended, ahead_store, 25);
+  auto ahead = extended.snapshot();
+  Chain behind(config);
+  behind.restore_from_store(store, &ahead);
+  ASSERT_EQ(behind.height(), 20u);
+  EXPECT_EQ(*behind.ledger(), *source.ledger());
+
+  // Pruned bodies can't be replayed; only a snapshot's ledger covers them.
+  auto pruned_dir = tmpdir("store_ledger_pruned");
+  fs::copy(dir / "chain.log", pruned_dir / "chain.log");
+  astro::storage::BlockStore pruned_store(pruned_dir, {.prune_compact_bytes = 0});
+  pruned_store.prune_bodies(10);
+  ASSERT_EQ(pruned_store.pruned_height(), 10u);
+  Chain unrebuildable(config);
+  EXPECT_THROW(unrebuildable.restore_from_store(pruned_store), std::runtime_error);
+  Chain covered(config);
+  covered.restore_from_store(pruned_store, &*loaded);
+  ASSERT_EQ(covered.height(), 20u);
+  EXPECT_EQ(*covered.ledger(), *source.ledger());
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "astro/core/trace.hpp"
+
+using namespace astro::core;
+
+static size_t count_of(const std::string& text, const std::string& needle) {
+  size_t n = 0;
+  for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) ++n;
+  return n;
+}
+
+TEST(Trace, RecordsSpansFromEveryThreadAsChromeJson) {
+  if (!trace::compiled_in) GTEST_SKIP() << "built without ASTRO_WITH_TRACE";
+  {
+    ASTRO_TRACE_SPAN("test.before_start");
+  }
+  trace::start();
+  {
+    ASTRO_TRACE_SPAN("test.outer");
+    ASTRO_TRACE_SPAN("test.inner");
+  }
+  std::thread([] {
+    ASTRO_TRACE_THREAD("test-thread");
+    ASTRO_TRACE_SPAN("test.on_thread");
+  }).join();
+  trace::stop();
+  {
+    ASTRO_TRACE_SPAN("test.after_stop");
+  }
+
+  std::ostringstream out;
+  trace::write_json(out);
+  const auto json = out.str();
+  EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+  EXPECT_EQ(count_of(json, "\"name\":\"test.outer\",\"cat\":\"astro\",\"ph\":\"X\""), 1u);
+  EXPECT_EQ(count_of(json, "\"name\":\"test.inner\""), 1u);
+  EXPECT_EQ(count_of(json, "\"name\":\"test.on_thread\""), 1u);
+  EXPECT_EQ(count_of(json, "\"args\":{\"name\":\"test-thread\"}"), 1u);
+  EXPECT_EQ(count_of(json, "test.before_start"), 0u);
+  EXPECT_EQ(count_of(json, "test.after_stop"), 0u);
+
+  // A new session starts empty.
+  trace::start();
+  trace::stop();
+  std::ostringstream again;
+  trace::write_json(again);
+  EXPECT_EQ(count_of(again.str(), "test.outer"), 0u);
+}
+
+TEST(Trace, KeepsTheLatestSpansWhenTheRingWraps) {
+  if (!trace::compiled_in) GTEST_SKIP() << "built without ASTRO_WITH_TRACE";
+  trace::start();
+  const uint64_t t0 = trace::now_ns();
+  trace::record("test.old", t0, t0 + 1);
+  for (size_t i = 0; i < trace::CAPACITY; ++i) trace::record("test.new", t0 + 2, t0 + 3);
+  trace::stop();
+
+  std::ostringstream out;
+  trace::write_json(out);
+  EXPECT_EQ(count_of(out.str(), "\"name\":\"test.new\""), trace::CAPACITY);
+  EXPECT_EQ(count_of(out.str(), "test.old"), 0u);
+}
+
+TEST(Trace, CanBeDumpedWhileThreadsRecord) {
+  if (!trace::compiled_in) GTEST_SKIP() << "built without ASTRO_WITH_TRACE";
+  trace::start();
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    while (!done.load()) {
+      ASTRO_TRACE_SPAN("test.busy");
+    }
+  });
+  for (int i = 0; i < 20; ++i) {
+    std::ostringstream out;
+    trace::write_json(out);
+    EXPECT_EQ(out.str().substr(out.str().size() - 4), "\n]}\n");
+  }
+  done.store(true);
+  writer.join();
+  trace::stop();
+}